@@ -78,13 +78,6 @@ std::ofstream goodput("./Task_B/goodput_B_Bic.txt");
 Ptr<PacketSink> sink;                         /* Pointer to the packet sink application */
 uint64_t lastTotalRx = 0;                     /* The value of the last total received bytes */
 
-uint32_t checkTimes;
-double avgQueueSize;
-
-
-std::stringstream filePlotQueue;
-std::stringstream filePlotQueueAvg;
-
 void
 CalculateGoodput ()
 {
@@ -96,27 +89,6 @@ CalculateGoodput ()
   Simulator::Schedule (MilliSeconds (100), &CalculateGoodput);
 }
 
-void
-CheckQueueSize (Ptr<QueueDisc> queue)
-{
-  uint32_t qSize = queue->GetCurrentSize ().GetValue ();
-
-  avgQueueSize += qSize;
-  checkTimes++;
-
-  // check queue size every 1/100 of a second
-  Simulator::Schedule (Seconds (0.01), &CheckQueueSize, queue);
-
-  std::ofstream fPlotQueue (filePlotQueue.str ().c_str (), std::ios::out|std::ios::app);
-  fPlotQueue << Simulator::Now ().GetSeconds () << " " << qSize << std::endl;
-  fPlotQueue.close ();
-
-  std::ofstream fPlotQueueAvg (filePlotQueueAvg.str ().c_str (), std::ios::out|std::ios::app);
-  fPlotQueueAvg << Simulator::Now ().GetSeconds () << " " << avgQueueSize / checkTimes << std::endl;
-  fPlotQueueAvg.close ();
-}
-
-
 int
 main (int argc, char *argv[])
 {
@@ -283,13 +255,6 @@ main (int argc, char *argv[])
 
   Simulator::Schedule (Seconds (1.1), &CalculateGoodput);
 
-  filePlotQueue << pathOut << "/" << "red-queue.plotme";
-  filePlotQueueAvg << pathOut << "/" << "red-queue_avg.plotme";
-
-  remove (filePlotQueue.str ().c_str ());
-  remove (filePlotQueueAvg.str ().c_str ());
-  Ptr<QueueDisc> queue = queueDiscs.Get (1);
-  // Simulator::ScheduleNow (&CheckQueueSize, queue);
 
   /* Flow Monitor */
   Ptr<FlowMonitor> flowMonitor;
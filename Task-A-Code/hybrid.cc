@@ -39,6 +39,7 @@
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/ssid.h"
+#include "ns3/wifi-net-device.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/on-off-helper.h"
 #include "ns3/yans-wifi-channel.h"
@@ -64,6 +65,8 @@
 #include "ns3/flow-monitor-module.h"
 
 #include "ns3/traffic-control-module.h"
+#include "ns3/queue-monitor.h"
+#include "ns3/flow-stats-collector.h"
 
 #include "ns3/energy-module.h"
 #include "ns3/wifi-radio-energy-model-helper.h"
@@ -78,13 +81,6 @@ std::ofstream goodput("./lastFiles/goodput_hybrid.txt");
 Ptr<PacketSink> sink;                         /* Pointer to the packet sink application */
 uint64_t lastTotalRx = 0;                     /* The value of the last total received bytes */
 
-uint32_t checkTimes;
-double avgQueueSize;
-
-
-std::stringstream filePlotQueue;
-std::stringstream filePlotQueueAvg;
-
 void
 CalculateGoodput ()
 {
@@ -112,27 +108,6 @@ TotalEnergy (double oldValue, double totalEnergy)
                  << "s Total energy consumed by radio = " << totalEnergy << "J");
 }
 
-void
-CheckQueueSize (Ptr<QueueDisc> queue)
-{
-  uint32_t qSize = queue->GetCurrentSize ().GetValue ();
-
-  avgQueueSize += qSize;
-  checkTimes++;
-
-  // check queue size every 1/100 of a second
-  Simulator::Schedule (Seconds (0.01), &CheckQueueSize, queue);
-
-  std::ofstream fPlotQueue (filePlotQueue.str ().c_str (), std::ios::out|std::ios::app);
-  fPlotQueue << Simulator::Now ().GetSeconds () << " " << qSize << std::endl;
-  fPlotQueue.close ();
-
-  std::ofstream fPlotQueueAvg (filePlotQueueAvg.str ().c_str (), std::ios::out|std::ios::app);
-  fPlotQueueAvg << Simulator::Now ().GetSeconds () << " " << avgQueueSize / checkTimes << std::endl;
-  fPlotQueueAvg.close ();
-}
-
-
 int
 main (int argc, char *argv[])
 {
@@ -150,6 +125,11 @@ main (int argc, char *argv[])
   uint32_t nWifi = 5;
   int flow = 5;
   int range = 200;
+  bool pacing = false;
+  bool ecn = false;
+  double errorRate = 0;
+  bool lossDiff = false;
+  bool flowXml = true;
 
 
   /* Command line argument parser setup. */
@@ -159,6 +139,11 @@ main (int argc, char *argv[])
   cmd.AddValue ("flow", "Number of flow", flow);
   cmd.AddValue ("redTest", "Do red test", redTest);
   cmd.AddValue ("range", "Number of flow", range);
+  cmd.AddValue ("pacing", "Pace senders, with TcpLibra setting the pacing rate", pacing);
+  cmd.AddValue ("ecn", "Mark with ECN at the RED bottleneck instead of dropping", ecn);
+  cmd.AddValue ("errorRate", "Packet error rate at the wifi stations", errorRate);
+  cmd.AddValue ("lossDiff", "Soften the TcpLibra decrease on losses it classifies as random", lossDiff);
+  cmd.AddValue ("flowXml", "Write the flow monitor XML to hybrid.flowmonitor", flowXml);
 
   cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
   cmd.AddValue ("dataRate", "Application data ate", dataRate);
@@ -178,6 +163,21 @@ main (int argc, char *argv[])
 
   /* Configure TCP Options */
   Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
+  if (pacing)
+    {
+      Config::SetDefault ("ns3::TcpSocketState::EnablePacing", BooleanValue (true));
+      Config::SetDefault ("ns3::TcpLibra::Pacing", BooleanValue (true));
+    }
+  if (ecn)
+    {
+      Config::SetDefault ("ns3::TcpSocketBase::UseEcn", StringValue ("On"));
+      Config::SetDefault ("ns3::TcpLibra::Ecn", BooleanValue (true));
+      Config::SetDefault ("ns3::RedQueueDisc::UseEcn", BooleanValue (true));
+    }
+  if (lossDiff)
+    {
+      Config::SetDefault ("ns3::TcpLibra::LossDifferentiation", BooleanValue (true));
+    }
 
   uint32_t meanPktSize = 1000;
 
@@ -318,6 +318,18 @@ main (int argc, char *argv[])
   // Config::Set("/NodeList/2/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
   // Config::Set("/NodeList/3/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
 
+  if (errorRate > 0)
+    {
+      Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+      em->SetAttribute ("ErrorUnit", EnumValue (RateErrorModel::ERROR_UNIT_PACKET));
+      em->SetAttribute ("ErrorRate", DoubleValue (errorRate));
+      for (uint32_t i = 0; i < staDevices.GetN (); i++)
+        {
+          DynamicCast<WifiNetDevice> (staDevices.Get (i))->GetPhy ()->SetPostReceptionErrorModel (em);
+        }
+    }
+
+  ApplicationContainer sinkApps;
   for(int i = 0; i < flow; i++){
     // csmaDevices.Get (i+1)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
 
@@ -325,6 +337,7 @@ main (int argc, char *argv[])
     PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9+i));
     ApplicationContainer sinkApp = sinkHelper.Install (wifiStaNodes.Get(i)); 
     sink = StaticCast<PacketSink> (sinkApp.Get (0));
+    sinkApps.Add (sinkApp);
 
     /* Install TCP/UDP Transmitter on the station */
     OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (staInterface.GetAddress (i), 9+i)));
@@ -344,14 +357,11 @@ main (int argc, char *argv[])
 
   Simulator::Schedule (Seconds (1.1), &CalculateGoodput);
 
-  filePlotQueue << pathOut << "/" << "red-queue.plotme";
-  filePlotQueueAvg << pathOut << "/" << "red-queue_avg.plotme";
-
-  remove (filePlotQueue.str ().c_str ());
-  remove (filePlotQueueAvg.str ().c_str ());
   Ptr<QueueDisc> queue = queueDiscs.Get (1);
   std::cout<<queue<<std::endl;
-  Simulator::ScheduleNow (&CheckQueueSize, queue);
+  QueueMonitor queueMonitor;
+  queueMonitor.Add (queue, pathOut + "/red-queue");
+  queueMonitor.StartSampling (Seconds (0.01));
 
   /* Flow Monitor */
   Ptr<FlowMonitor> flowMonitor;
@@ -359,14 +369,21 @@ main (int argc, char *argv[])
   flowMonitor=flowHelper.InstallAll();
 
   flowMonitor->CheckForLostPackets ();
+  FlowStatsCollector flowStatsCollector (flowMonitor);
 
   /* Start Simulation */
   Simulator::Stop (Seconds (simulationTime + 1));
   //AnimationInterface anim ("./lastFiles/update_hybrid.xml");
   Simulator::Run ();
+  queueMonitor.Close ();
 
    /* Flow Monitor File  */
-  flowMonitor->SerializeToXmlFile("./Task_A/hybrid.flowmonitor",false,false);
+  if (flowXml)
+    {
+      flowMonitor->SerializeToXmlFile("./Task_A/hybrid.flowmonitor",false,false);
+    }
+  /* What flowmon.py prints for the XML */
+  flowStatsCollector.Finish (pathOut + "/flowstats.json").PrintThroughput (std::cout);
 
   //See implementation of goodput here: https://www.nsnam.org/doxygen/traffic-control_8cc_source.html
   //delaySum: the sum of all end-to-end delays for all received packets of the flow
@@ -376,6 +393,20 @@ main (int argc, char *argv[])
   double averageGoodput = ((sink->GetTotalRx () * 8) / (1e6 * simulationTime));
 
   std::cout << "Average Goodput: "<<averageGoodput<<"Mbit/s" <<std::endl;
+  uint64_t totalRx = 0;
+  for (uint32_t i = 0; i < sinkApps.GetN (); i++)
+    {
+      totalRx += StaticCast<PacketSink> (sinkApps.Get (i))->GetTotalRx ();
+    }
+  std::cout << "Aggregate Goodput: " << totalRx * 8 / (1e6 * simulationTime) << "Mbit/s" << std::endl;
+  std::cout << "Bottleneck drops: " << queue->GetStats ().nTotalDroppedPackets << std::endl;
+  std::cout << "Bottleneck ECN marks: " << queue->GetStats ().nTotalMarkedPackets << std::endl;
+  uint32_t lostPackets = 0;
+  for (auto const &flowStats : flowMonitor->GetFlowStats ())
+    {
+      lostPackets += flowStats.second.lostPackets;
+    }
+  std::cout << "Lost packets (retransmitted): " << lostPackets << std::endl;
    
 
   Simulator::Destroy ();
@@ -36,10 +36,25 @@ int main (int argc, char** argv) {
   uint32_t Lrwpan_nodes = 4;
   std::string dataRate = "200Kbps"; 
   uint32_t payload = 100;
+  double errorRate = 0;
+  bool lossDiff = false;
   TypeId tcpTid;
   std::string tcpVariant = "ns3::TcpNewReno";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("range", "Range of the LR-WPAN radios in meters", range);
+  cmd.AddValue ("tcpVariant", "TypeId of the TCP variant, e.g. ns3::TcpLibra", tcpVariant);
+  cmd.AddValue ("errorRate", "Packet error rate on the CSMA link between the border routers", errorRate);
+  cmd.AddValue ("lossDiff", "Soften the TcpLibra decrease on losses it classifies as random", lossDiff);
+  cmd.Parse (argc, argv);
+
   NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (tcpVariant, &tcpTid), "TypeId " << tcpVariant << " not found");
   Config::SetDefault ("ns3::TcpL4Protocol::SocketType", TypeIdValue (TypeId::LookupByName (tcpVariant)));
+  if (lossDiff)
+    {
+      Config::SetDefault ("ns3::TcpLibra::LossDifferentiation", BooleanValue (true));
+    }
 
 
   NodeContainer Lw_nodes_left;
@@ -109,6 +124,17 @@ int main (int argc, char** argv) {
   NetDeviceContainer csma_devices = csmahelper.Install (Csma_Nodes);
   csmahelper.SetChannelAttribute ("DataRate", StringValue (dataRate));
 
+  if (errorRate > 0)
+    {
+      Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+      em->SetAttribute ("ErrorUnit", EnumValue (RateErrorModel::ERROR_UNIT_PACKET));
+      em->SetAttribute ("ErrorRate", DoubleValue (errorRate));
+      for (uint32_t i = 0; i < csma_devices.GetN (); i++)
+        {
+          csma_devices.Get (i)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+        }
+    }
+
   Ipv6AddressHelper ipv6;
 
   ipv6.SetBase (Ipv6Address ("2002:d00d::"), Ipv6Prefix (64));
@@ -142,6 +168,7 @@ int main (int argc, char** argv) {
   }
 
   uint32_t ports = 9;
+  ApplicationContainer allSinks;
 
   for( uint32_t i=1; i<Lrwpan_nodes; i++ ) {
     // BulkSendHelper sourceApp ("ns3::TcpSocketFactory",
@@ -160,6 +187,7 @@ int main (int argc, char** argv) {
     ApplicationContainer sinkApps = sinkApp.Install (Csma_Nodes.Get(0));
     sinkApps.Start (Seconds (0.0));
     sinkApps.Stop (Seconds (simulationTime));
+    allSinks.Add (sinkApps);
     
     ports++;
   }
@@ -182,6 +210,7 @@ int main (int argc, char** argv) {
     ApplicationContainer sinkApps = sinkApp.Install (Lw_nodes_right.Get(i));
     sinkApps.Start (Seconds (10.0));
     sinkApps.Stop (Seconds (simulationTime));
+    allSinks.Add (sinkApps);
     
     ports++;
   }
@@ -197,6 +226,13 @@ int main (int argc, char** argv) {
 
   flowHelper.SerializeToXmlFile ("./Task_A/LowRate.flowmonitor", false, false);
 
+  uint64_t totalRx = 0;
+  for (uint32_t i = 0; i < allSinks.GetN (); i++)
+    {
+      totalRx += StaticCast<PacketSink> (allSinks.Get (i))->GetTotalRx ();
+    }
+  std::cout << "Aggregate Goodput: " << totalRx * 8 / (1e3 * simulationTime) << "Kbit/s" << std::endl;
+
   Simulator::Destroy ();
 
   return 0;
@@ -64,56 +64,179 @@
 #include "ns3/flow-monitor-module.h"
 
 #include "ns3/traffic-control-module.h"
+#include "ns3/tcp-libra.h"
+#include "ns3/queue-monitor.h"
+#include "ns3/goodput-monitor.h"
+#include "ns3/flow-stats-collector.h"
 
 #include "ns3/energy-module.h"
 #include "ns3/wifi-radio-energy-model-helper.h"
 
 #include "ns3/netanim-module.h"
 
+#include <algorithm>
+
 NS_LOG_COMPONENT_DEFINE ("fullwired");
 
 using namespace ns3;
 
-std::ofstream goodput("./Task_B/goodput_B_Bic.txt");
-Ptr<PacketSink> sink;                         /* Pointer to the packet sink application */
-uint64_t lastTotalRx = 0;                     /* The value of the last total received bytes */
+ApplicationContainer sinkApps;                /* Packet sinks of all flows */
+uint64_t lastAggregateRx = 0;                 /* Bytes received by all sinks at the last sample */
+double bottleneckBitRate;                     /* Bit rate of the point-to-point link */
+Time fullUtilizationTime;                     /* First sample with the bottleneck at 90% */
+
+std::ofstream cwndTrace;                      /* "time flow cwnd" lines of the traced senders */
+
+/* Flow completion time test: short flows, one after the other, from the
+   first TcpLibra sender to its sink */
+const uint32_t fctSizes[] = {10000, 50000, 100000, 200000, 500000};
+const uint32_t nFctSizes = sizeof (fctSizes) / sizeof (fctSizes[0]);
+uint32_t fctFlows = 0;                        /* Number of short flows, 0 for the OnOff workload */
+uint32_t fctIndex = 0;                        /* Short flow in progress */
+Ptr<Node> fctSender;
+Address fctSinkAddress;
+Ptr<PacketSink> fctSink;
+uint64_t fctRxAtStart;                        /* Sink bytes when the current flow started */
+Time fctStart;
+std::map<uint32_t, std::vector<double> > fctResults;  /* Completion times in ms, by flow size */
+
+std::map<std::string, Time> recoveryStart;    /* Start of the ongoing recovery, by socket */
+uint32_t recoveryEpisodes = 0;                /* Fast recovery episodes completed */
+Time recoveryTime;                            /* Total time spent in those episodes */
+std::vector<double> rttSamples;               /* RTT samples of the traced senders, in ms */
+
+uint64_t
+GetAggregateRx ()
+{
+  uint64_t totalRx = 0;
+  for (uint32_t i = 0; i < sinkApps.GetN (); i++)
+    {
+      totalRx += StaticCast<PacketSink> (sinkApps.Get (i))->GetTotalRx ();
+    }
+  return totalRx;
+}
 
-uint32_t checkTimes;
-double avgQueueSize;
+/* Print the aggregate goodput of the last interval; per-flow goodput is
+   sampled by the GoodputMonitor in main */
+void
+CalculateGoodput (Time interval)
+{
+  Time now = Simulator::Now ();                                         /* Return the simulator's virtual time. */
+  uint64_t aggregateRx = GetAggregateRx ();
+  double aggregate = (aggregateRx - lastAggregateRx) * (double) 8 / interval.GetSeconds (); /* bit/s */
+  lastAggregateRx = aggregateRx;
+  std::cout << now.GetSeconds () << "s: \t" << aggregate / 1e6 << " Mbit/s" << std::endl;
+  if (fullUtilizationTime.IsZero () && aggregate >= 0.9 * bottleneckBitRate)
+    {
+      fullUtilizationTime = now;
+    }
+  Simulator::Schedule (interval, &CalculateGoodput, interval);
+}
 
+/* Aggregate and per-flow min/median/max goodput of the flows of a variant, all if empty */
+void
+PrintGoodput (const GoodputMatrix &matrix, const std::string &variant)
+{
+  GoodputStats stats = matrix.GetStats (variant);
+  std::cout << "Goodput " << (variant.empty () ? "all flows" : variant) << ": aggregate "
+            << stats.aggregate / 1e6 << " Mbit/s, per flow min " << stats.min / 1e6 << " median "
+            << stats.median / 1e6 << " max " << stats.max / 1e6 << " Mbit/s" << std::endl;
+}
 
-std::stringstream filePlotQueue;
-std::stringstream filePlotQueueAvg;
+/* Jain's fairness index of the goodput of the sinks of flows first, first + step, ... */
+double
+JainIndex (uint32_t first, uint32_t step)
+{
+  double sum = 0;
+  double sumSquares = 0;
+  uint32_t n = 0;
+  for (uint32_t i = first; i < sinkApps.GetN (); i += step)
+    {
+      double rx = StaticCast<PacketSink> (sinkApps.Get (i))->GetTotalRx ();
+      sum += rx;
+      sumSquares += rx * rx;
+      n++;
+    }
+  return sumSquares > 0 ? sum * sum / (n * sumSquares) : 0;
+}
 
 void
-CalculateGoodput ()
+CwndChange (uint32_t flowId, uint32_t oldCwnd, uint32_t newCwnd)
 {
-  Time now = Simulator::Now ();                                         /* Return the simulator's virtual time. */
-  double cur = (sink->GetTotalRx () - lastTotalRx) * (double) 8 / 1e5;     /* Convert Application RX Packets to MBits. */
-  std::cout << now.GetSeconds () << "s: \t" << cur << " Mbit/s" << std::endl;
-  goodput << now.GetSeconds () <<" "<< cur << std::endl;
-  lastTotalRx = sink->GetTotalRx ();
-  Simulator::Schedule (MilliSeconds (100), &CalculateGoodput);
+  cwndTrace << Simulator::Now ().GetSeconds () << " " << flowId << " " << newCwnd << "\n";
+}
+
+void
+StartFctFlow ()
+{
+  BulkSendHelper source ("ns3::TcpSocketFactory", fctSinkAddress);
+  source.SetAttribute ("MaxBytes", UintegerValue (fctSizes[fctIndex % nFctSizes]));
+  source.Install (fctSender);
+  fctRxAtStart = fctSink->GetTotalRx ();
+  fctStart = Simulator::Now ();
+}
+
+void
+FctRx (Ptr<const Packet> packet, const Address &from)
+{
+  uint32_t size = fctSizes[fctIndex % nFctSizes];
+  if (fctIndex >= fctFlows || fctSink->GetTotalRx () - fctRxAtStart < size)
+    {
+      return;
+    }
+  fctResults[size].push_back ((Simulator::Now () - fctStart).GetSeconds () * 1000);
+  if (++fctIndex < fctFlows)
+    {
+      Simulator::Schedule (MilliSeconds (10), &StartFctFlow);
+    }
 }
 
 void
-CheckQueueSize (Ptr<QueueDisc> queue)
+CongStateChange (std::string context, TcpSocketState::TcpCongState_t oldState,
+                 TcpSocketState::TcpCongState_t newState)
 {
-  uint32_t qSize = queue->GetCurrentSize ().GetValue ();
+  if (newState == TcpSocketState::CA_RECOVERY)
+    {
+      recoveryStart[context] = Simulator::Now ();
+    }
+  else if (oldState == TcpSocketState::CA_RECOVERY && recoveryStart.count (context) > 0)
+    {
+      recoveryTime += Simulator::Now () - recoveryStart[context];
+      recoveryEpisodes++;
+      recoveryStart.erase (context);
+    }
+}
 
-  avgQueueSize += qSize;
-  checkTimes++;
+void
+TraceRecovery (uint32_t nodeId, uint32_t socketId)
+{
+  std::stringstream path;
+  path << "/NodeList/" << nodeId << "/$ns3::TcpL4Protocol/SocketList/" << socketId << "/CongState";
+  Config::Connect (path.str (), MakeCallback (&CongStateChange));
+}
 
-  // check queue size every 1/100 of a second
-  Simulator::Schedule (Seconds (0.01), &CheckQueueSize, queue);
+void
+RttChange (Time oldRtt, Time newRtt)
+{
+  rttSamples.push_back (newRtt.GetSeconds () * 1000);
+}
 
-  std::ofstream fPlotQueue (filePlotQueue.str ().c_str (), std::ios::out|std::ios::app);
-  fPlotQueue << Simulator::Now ().GetSeconds () << " " << qSize << std::endl;
-  fPlotQueue.close ();
+void
+TraceRtt (uint32_t nodeId, uint32_t socketId)
+{
+  std::stringstream path;
+  path << "/NodeList/" << nodeId << "/$ns3::TcpL4Protocol/SocketList/" << socketId << "/RTT";
+  Config::ConnectWithoutContext (path.str (), MakeCallback (&RttChange));
+}
 
-  std::ofstream fPlotQueueAvg (filePlotQueueAvg.str ().c_str (), std::ios::out|std::ios::app);
-  fPlotQueueAvg << Simulator::Now ().GetSeconds () << " " << avgQueueSize / checkTimes << std::endl;
-  fPlotQueueAvg.close ();
+/* The sender socket only exists once its OnOff application has started */
+void
+TraceCwnd (uint32_t nodeId, uint32_t socketId, uint32_t flowId)
+{
+  std::stringstream path;
+  path << "/NodeList/" << nodeId << "/$ns3::TcpL4Protocol/SocketList/" << socketId
+       << "/CongestionWindow";
+  Config::ConnectWithoutContext (path.str (), MakeBoundCallback (&CwndChange, flowId));
 }
 
 
@@ -126,9 +249,33 @@ main (int argc, char *argv[])
   std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
   double simulationTime = 10;                        /* Simulation time in seconds. */
 
+  std::string bottleneckRate = "100Mbps";           /* Point-to-point link datarate. */
   std::string redLinkDataRate = "1.5Mbps";
   std::string redLinkDelay = "20ms";
   uint32_t redTest=0;
+  bool traceQueue = false;
+  bool traceQueueEvents = false;
+  bool queueBinary = false;
+  bool traceCwnd = false;
+  bool traceInternals = false;
+  bool pacing = false;
+  bool ecn = false;
+  bool rateSample = false;
+  double onTime = 1;                                 /* OnOff on period in seconds. */
+  double offTime = 0;                                /* OnOff off period in seconds. */
+  double goodputInterval = 0.1;                      /* Goodput sampling interval in seconds. */
+  bool flowXml = true;
+  double flowStatsInterval = 0;                      /* Flow stats snapshot period in seconds. */
+  std::string appRate = "";                          /* OnOff rate, dataRate if empty. */
+  bool metricsCache = false;
+  bool traceRecovery = false;
+  bool coupled = false;
+  bool sharedHost = false;
+  bool traceRtt = false;
+  bool dropTail = false;
+  bool sack = true;
+  double burstErrorRate = 0;                         /* Probability of a loss burst per packet. */
+  uint32_t burstSize = 3;                            /* Packets lost per burst. */
 
   uint32_t nCsma = 49;
   int flow = 50;
@@ -138,15 +285,49 @@ main (int argc, char *argv[])
   cmd.AddValue ("nCsma", "Number of \"extra\" CSMA nodes/devices", nCsma);
   cmd.AddValue ("flow", "Number of flow", flow);
   cmd.AddValue ("redTest", "Do red test", redTest);
+  cmd.AddValue ("traceQueue", "Sample the bottleneck queue into red-queue.plotme", traceQueue);
+  cmd.AddValue ("traceQueueEvents", "Log every bottleneck queue length change instead of "
+                "sampling every 10 ms", traceQueueEvents);
+  cmd.AddValue ("queueBinary", "Write the queue log to red-queue.bin instead of text", queueBinary);
+  cmd.AddValue ("traceCwnd", "Write the senders' cwnd to cwnd.txt", traceCwnd);
+  cmd.AddValue ("traceInternals", "Record TcpLibra internals to libra-internals.bin", traceInternals);
+  cmd.AddValue ("pacing", "Pace senders, with TcpLibra setting the pacing rate", pacing);
+  cmd.AddValue ("ecn", "Mark with ECN at the RED bottleneck instead of dropping", ecn);
+  cmd.AddValue ("rateSample", "Feed TcpLibra the delivery rate samples of the socket", rateSample);
+  cmd.AddValue ("onTime", "On period of the OnOff senders in seconds", onTime);
+  cmd.AddValue ("offTime", "Off period of the OnOff senders in seconds", offTime);
+  cmd.AddValue ("flowXml", "Write the flow monitor XML to fullwired.flowmonitor", flowXml);
+  cmd.AddValue ("flowStatsInterval", "Append the flow statistics to flowstats.csv every this "
+                "many seconds, 0 for the end of the run only", flowStatsInterval);
+  cmd.AddValue ("goodputInterval", "Interval of the per-flow goodput samples in goodput.txt, "
+                "in seconds", goodputInterval);
+  cmd.AddValue ("appRate", "Sending rate of the OnOff senders, dataRate if empty", appRate);
+  cmd.AddValue ("fctFlows", "Run this many 10-500KB flows in turn instead of the OnOff senders "
+                "and report their completion times", fctFlows);
+  cmd.AddValue ("metricsCache", "Warm start TcpLibra connections from the node's cache", metricsCache);
+  cmd.AddValue ("traceRecovery", "Report the number and mean duration of fast recoveries", traceRecovery);
+  cmd.AddValue ("sack", "Enable SACK", sack);
+  cmd.AddValue ("coupled", "Couple the TcpLibra flows of each sender node into one group", coupled);
+  cmd.AddValue ("sharedHost", "Send all TcpLibra flows between one pair of hosts, as parallel "
+                "connections", sharedHost);
+  cmd.AddValue ("traceRtt", "Report the p50 and p99 RTT of the TcpLibra senders", traceRtt);
+  cmd.AddValue ("dropTail", "Use a 1000-packet FIFO at the bottleneck instead of RED", dropTail);
+  cmd.AddValue ("burstErrorRate", "Probability of a loss burst per packet at the bottleneck", burstErrorRate);
+  cmd.AddValue ("burstSize", "Packets lost per burst", burstSize);
 
   cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
   cmd.AddValue ("dataRate", "Application data ate", dataRate);
+  cmd.AddValue ("bottleneckRate", "Point-to-point bottleneck datarate", bottleneckRate);
   cmd.AddValue ("tcpVariant", "Transport protocol to use: TcpNewReno, "
                 "TcpHybla, TcpHighSpeed, TcpHtcp, TcpVegas, TcpScalable, TcpVeno, "
                 "TcpBic, TcpYeah, TcpIllinois, TcpWestwood, TcpWestwoodPlus, TcpLedbat ", tcpVariant);
   cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.Parse (argc, argv);
+  if (appRate.empty ())
+    {
+      appRate = dataRate;
+    }
 
   tcpVariant = std::string ("ns3::") + tcpVariant;
   // Select TCP variant
@@ -156,6 +337,35 @@ main (int argc, char *argv[])
 
   /* Configure TCP Options */
   Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
+  Config::SetDefault ("ns3::TcpSocketBase::Sack", BooleanValue (sack));
+  /* PRR spreads the TcpLibra decrease over the recovery */
+  Config::SetDefault ("ns3::TcpL4Protocol::RecoveryType", TypeIdValue (TcpPrrRecovery::GetTypeId ()));
+  if (pacing)
+    {
+      Config::SetDefault ("ns3::TcpSocketState::EnablePacing", BooleanValue (true));
+      Config::SetDefault ("ns3::TcpLibra::Pacing", BooleanValue (true));
+    }
+  if (ecn)
+    {
+      Config::SetDefault ("ns3::TcpSocketBase::UseEcn", StringValue ("On"));
+      Config::SetDefault ("ns3::TcpLibra::Ecn", BooleanValue (true));
+      Config::SetDefault ("ns3::RedQueueDisc::UseEcn", BooleanValue (true));
+    }
+  if (rateSample)
+    {
+      Config::SetDefault ("ns3::TcpLibra::RateSample", BooleanValue (true));
+    }
+  if (coupled)
+    {
+      /* Groups only take the sending sockets of one node; with one flow
+         per node that needs sharedHost */
+      Config::SetDefault ("ns3::TcpLibra::CouplingGroup", UintegerValue (1));
+    }
+  if (metricsCache)
+    {
+      Config::SetDefault ("ns3::TcpLibra::MetricsCache", BooleanValue (true));
+    }
+  NS_ABORT_MSG_IF (fctFlows > 0 && flow < 2, "fctFlows needs a TcpLibra sender, flow >= 2");
 
   uint32_t meanPktSize = 1000;
 
@@ -173,8 +383,15 @@ main (int argc, char *argv[])
   //tchPfifo.AddInternalQueues (handle, 3, "ns3::DropTailQueue", "MaxSize", StringValue ("1000p"));
 
   TrafficControlHelper tchRed;
-  tchRed.SetRootQueueDisc ("ns3::RedQueueDisc", "LinkBandwidth", StringValue (redLinkDataRate),
-                          "LinkDelay", StringValue (redLinkDelay));
+  if (dropTail)
+    {
+      tchRed.SetRootQueueDisc ("ns3::FifoQueueDisc", "MaxSize", StringValue ("1000p"));
+    }
+  else
+    {
+      tchRed.SetRootQueueDisc ("ns3::RedQueueDisc", "LinkBandwidth", StringValue (redLinkDataRate),
+                               "LinkDelay", StringValue (redLinkDelay));
+    }
 
    
   NodeContainer p2pNodes;
@@ -188,7 +405,7 @@ main (int argc, char *argv[])
   }
   else{
     pointToPoint.SetQueue ("ns3::DropTailQueue");
-    pointToPoint.SetDeviceAttribute ("DataRate", StringValue (dataRate));
+    pointToPoint.SetDeviceAttribute ("DataRate", StringValue (bottleneckRate));
     pointToPoint.SetChannelAttribute ("Delay", StringValue ("10ms"));
   }
   
@@ -255,8 +472,19 @@ main (int argc, char *argv[])
   em->SetAttribute ("ErrorRate", DoubleValue (0.000000001));
 
   p2pDevices.Get(0)->SetAttribute("ReceiveErrorModel",PointerValue(em));
+  if (burstErrorRate > 0)
+    {
+      /* Data crosses the bottleneck from n1 to n0 */
+      Ptr<BurstErrorModel> burst = CreateObject<BurstErrorModel> ();
+      burst->SetAttribute ("ErrorRate", DoubleValue (burstErrorRate));
+      std::stringstream burstSizeRv;
+      burstSizeRv << "ns3::ConstantRandomVariable[Constant=" << burstSize << "]";
+      burst->SetAttribute ("BurstSize", StringValue (burstSizeRv.str ()));
+      p2pDevices.Get (0)->SetAttribute ("ReceiveErrorModel", PointerValue (burst));
+    }
   p2pDevices.Get(1)->SetAttribute("ReceiveErrorModel",PointerValue(em));
 
+  GoodputMonitor goodputMonitor;
   for(int i = 0; i < flow; i++){
     csmaDevices_left.Get (i)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
     csmaDevices_right.Get (i)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
@@ -268,6 +496,10 @@ main (int argc, char *argv[])
       tid = TypeId::LookupByName ("ns3::TcpBic");
     else
       tid = TypeId::LookupByName ("ns3::TcpLibra");
+    /* With sharedHost the TcpLibra flows all run between the hosts of
+       flow 1, the sender sockets in flow order */
+    uint32_t host = sharedHost && i % 2 == 1 ? 1 : i;
+    uint32_t socketId = host == 1 ? i / 2 : 0;
     nodeId_right << csmaNodes_right.Get(i)->GetId ();
     std::string specificNode = "/NodeList/" + nodeId_right.str () + "/$ns3::TcpL4Protocol/SocketType";
     // std::cout<<nodeId_right.str()<<std::endl;
@@ -275,34 +507,93 @@ main (int argc, char *argv[])
   
 
     PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9+i));
-    ApplicationContainer sinkApp = sinkHelper.Install (csmaNodes_left.Get(i)); 
-    sink = StaticCast<PacketSink> (sinkApp.Get (0));
+    ApplicationContainer sinkApp = sinkHelper.Install (csmaNodes_left.Get(host)); 
+    sinkApps.Add (sinkApp);
+    goodputMonitor.Add (sinkApp.Get (0), tid.GetName ());
+
+    if (fctFlows > 0)
+      {
+        continue;
+      }
 
     /* Install TCP/UDP Transmitter on the station */
-    OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (csmaInterfaces_left.GetAddress (i), 9+i)));
+    OnOffHelper server ("ns3::TcpSocketFactory", (InetSocketAddress (csmaInterfaces_left.GetAddress (host), 9+i)));
     server.SetAttribute ("PacketSize", UintegerValue (payloadSize));
-    server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=1]"));
-    server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
-    server.SetAttribute ("DataRate", DataRateValue (DataRate (dataRate)));
-    ApplicationContainer serverApp = server.Install (csmaNodes_right.Get(i)); // server node assign
+    std::stringstream on, off;
+    on << "ns3::ConstantRandomVariable[Constant=" << onTime << "]";
+    off << "ns3::ConstantRandomVariable[Constant=" << offTime << "]";
+    server.SetAttribute ("OnTime", StringValue (on.str ()));
+    server.SetAttribute ("OffTime", StringValue (off.str ()));
+    server.SetAttribute ("DataRate", DataRateValue (DataRate (appRate)));
+    ApplicationContainer serverApp = server.Install (csmaNodes_right.Get(host)); // server node assign
 
     /* Start Applications */
     sinkApp.Start (Seconds (0.0));
     serverApp.Start (Seconds (1.0));
+
+    if (traceCwnd)
+      {
+        Simulator::Schedule (Seconds (1.001), &TraceCwnd, csmaNodes_right.Get (host)->GetId (),
+                             socketId, i);
+      }
+    if (traceRecovery)
+      {
+        Simulator::Schedule (Seconds (1.001), &TraceRecovery, csmaNodes_right.Get (host)->GetId (),
+                             socketId);
+      }
+    if (traceRtt && i % 2 == 1)
+      {
+        Simulator::Schedule (Seconds (1.001), &TraceRtt, csmaNodes_right.Get (host)->GetId (),
+                             socketId);
+      }
   }
 
+  if (fctFlows > 0)
+    {
+      /* Flow 1 is the first TcpLibra sender */
+      PacketSinkHelper fctSinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 7000));
+      fctSink = StaticCast<PacketSink> (fctSinkHelper.Install (csmaNodes_left.Get (1)).Get (0));
+      fctSink->TraceConnectWithoutContext ("Rx", MakeCallback (&FctRx));
+      fctSinkAddress = InetSocketAddress (csmaInterfaces_left.GetAddress (1), 7000);
+      fctSender = csmaNodes_right.Get (1);
+      Simulator::Schedule (Seconds (1.0), &StartFctFlow);
+    }
+
   std::string pathOut;
   pathOut = "./Task_B"; // Current directory
 
-  Simulator::Schedule (Seconds (1.1), &CalculateGoodput);
-
-  filePlotQueue << pathOut << "/" << "red-queue.plotme";
-  filePlotQueueAvg << pathOut << "/" << "red-queue_avg.plotme";
-
-  remove (filePlotQueue.str ().c_str ());
-  remove (filePlotQueueAvg.str ().c_str ());
+  bottleneckBitRate = DataRate (redTest == 1 ? redLinkDataRate : bottleneckRate).GetBitRate ();
+
+  /* The senders start at 1s */
+  Simulator::Schedule (Seconds (1.0), &GoodputMonitor::Start, &goodputMonitor,
+                       Seconds (goodputInterval), Seconds (simulationTime));
+  Simulator::Schedule (Seconds (1.0 + goodputInterval), &CalculateGoodput,
+                       Seconds (goodputInterval));
+
+  if (traceCwnd)
+    {
+      cwndTrace.open ((pathOut + "/cwnd.txt").c_str ());
+    }
+  TcpLibraTraceRing internalsSink;
+  if (traceInternals)
+    {
+      internalsSink.Open (pathOut + "/libra-internals.bin");
+      TcpLibra::SetInternalsSink (&internalsSink);
+    }
   Ptr<QueueDisc> queue = queueDiscs.Get (1);
-  // Simulator::ScheduleNow (&CheckQueueSize, queue);
+  QueueMonitor queueMonitor (queueBinary ? QueueMonitorBuffer::BINARY : QueueMonitorBuffer::TEXT);
+  if (traceQueue || traceQueueEvents)
+    {
+      queueMonitor.Add (queue, pathOut + "/red-queue");
+      if (traceQueueEvents)
+        {
+          queueMonitor.StartTracing ();
+        }
+      else
+        {
+          queueMonitor.StartSampling (Seconds (0.01));
+        }
+    }
 
   /* Flow Monitor */
   Ptr<FlowMonitor> flowMonitor;
@@ -310,22 +601,104 @@ main (int argc, char *argv[])
   flowMonitor=flowHelper.InstallAll();
 
   flowMonitor->CheckForLostPackets ();
+  /* Ids up to 50 count in the Jain's indexes, as in Fairness.py */
+  FlowStatsCollector flowStatsCollector (flowMonitor, 50);
+  if (flowStatsInterval > 0)
+    {
+      flowStatsCollector.StartSnapshots (Seconds (flowStatsInterval), pathOut + "/flowstats.csv");
+    }
 
   Simulator::Stop (Seconds (simulationTime + 1));
   //AnimationInterface anim ("./lastFiles/update_hybrid.xml");
+  SystemWallClockMs wallClock;
+  wallClock.Start ();
   Simulator::Run ();
+  int64_t wallClockMs = wallClock.End ();
+  queueMonitor.Close ();
+  goodputMonitor.Stop ();
+  goodputMonitor.GetMatrix ().Write (pathOut + "/goodput.txt");
+  if (traceInternals)
+    {
+      TcpLibra::SetInternalsSink (0);
+      internalsSink.Close ();
+      std::cout << "Internals samples dropped: " << internalsSink.GetDropped () << std::endl;
+    }
 
    /* Flow Monitor File  */
-  flowMonitor->SerializeToXmlFile("./Task_B/fullwired.flowmonitor",false,false);
+  if (flowXml)
+    {
+      flowMonitor->SerializeToXmlFile("./Task_B/fullwired.flowmonitor",false,false);
+    }
+  /* What flowmon.py and Fairness.py print for the XML */
+  FlowStatsSummary flowSummary = flowStatsCollector.Finish (pathOut + "/flowstats.json");
+  flowSummary.PrintThroughput (std::cout);
+  flowSummary.PrintFairness (std::cout);
 
   //See implementation of goodput here: https://www.nsnam.org/doxygen/traffic-control_8cc_source.html
   //delaySum: the sum of all end-to-end delays for all received packets of the flow
   //Fairness: https://github.com/urstrulymahesh/Networks-Simulator-ns3-
   //Queuing Policy: https://www.nsnam.org/docs/release/3.14/models/html/queue.html
 
-  double averageGoodput = ((sink->GetTotalRx () * 8) / (1e6 * simulationTime));
+  /* Mean over the flows, not the last flow alone */
+  const GoodputMatrix &goodputMatrix = goodputMonitor.GetMatrix ();
+  GoodputStats allFlows = goodputMatrix.GetStats ("");
+  double averageGoodput = allFlows.flows > 0 ? allFlows.aggregate / (1e6 * allFlows.flows) : 0;
 
   std::cout << "Average Goodput(Packets): "<<(averageGoodput*1e6/1000) <<std::endl;
+  std::cout << "Aggregate Goodput: " << allFlows.aggregate / 1e6 << "Mbit/s" << std::endl;
+  PrintGoodput (goodputMatrix, "");
+  PrintGoodput (goodputMatrix, "ns3::TcpBic");
+  PrintGoodput (goodputMatrix, "ns3::TcpLibra");
+
+  double utilization = (GetAggregateRx () * 8) / (bottleneckBitRate * simulationTime);
+  std::cout << "Bottleneck utilization: " << utilization * 100 << " %" << std::endl;
+  /* Odd flows run TcpLibra */
+  std::cout << "Jain's index: TcpLibra flows " << JainIndex (1, 2) << ", all flows "
+            << JainIndex (0, 1) << std::endl;
+  std::cout << "Simulation wall-clock: " << wallClockMs << " ms" << std::endl;
+  std::cout << "Bottleneck drops: " << queue->GetStats ().nTotalDroppedPackets << std::endl;
+  std::cout << "Bottleneck ECN marks: " << queue->GetStats ().nTotalMarkedPackets << std::endl;
+  uint32_t lostPackets = 0;
+  for (auto const &flowStats : flowMonitor->GetFlowStats ())
+    {
+      lostPackets += flowStats.second.lostPackets;
+    }
+  std::cout << "Lost packets (retransmitted): " << lostPackets << std::endl;
+  if (traceRtt && !rttSamples.empty ())
+    {
+      std::sort (rttSamples.begin (), rttSamples.end ());
+      std::cout << "TcpLibra RTT: p50 " << rttSamples[rttSamples.size () / 2] << " ms, p99 "
+                << rttSamples[rttSamples.size () * 99 / 100] << " ms" << std::endl;
+    }
+  if (traceRecovery)
+    {
+      std::cout << "Recovery episodes: " << recoveryEpisodes << ", mean duration "
+                << (recoveryEpisodes > 0 ? recoveryTime.GetSeconds () * 1000 / recoveryEpisodes : 0)
+                << " ms" << std::endl;
+    }
+  for (auto const &result : fctResults)
+    {
+      double sum = 0;
+      for (double fct : result.second)
+        {
+          sum += fct;
+        }
+      std::cout << "FCT " << result.first / 1000 << " KB: " << sum / result.second.size ()
+                << " ms mean over " << result.second.size () << " flows" << std::endl;
+    }
+  if (fctIndex < fctFlows)
+    {
+      std::cout << "FCT: " << fctIndex << " of " << fctFlows << " flows completed" << std::endl;
+    }
+  if (fullUtilizationTime.IsZero ())
+    {
+      std::cout << "Time to 90% utilization: not reached" << std::endl;
+    }
+  else
+    {
+      /* Senders start at 1s */
+      std::cout << "Time to 90% utilization: " << fullUtilizationTime.GetSeconds () - 1.0 << " s" << std::endl;
+    }
    
 
   Simulator::Destroy ();
@@ -0,0 +1,364 @@
+#!/bin/sh
+# Benchmarks for TcpLibra.
+#
+# Run from anywhere; NS3_DIR must point at an ns-3.35 tree that has
+# tcp-libra.{h,cc}, queue-monitor.{h,cc} and the tcp-libra-*.h and
+# queue-monitor-buffer.h headers in src/internet/model (listed in its
+# wscript), goodput-monitor.{h,cc} and goodput-matrix.h in
+# src/applications/model, flow-stats-collector.{h,cc} and
+# flow-stats-summary.h in src/flow-monitor/model, and Wired.cc copied to
+# scratch/Wired.cc.
+# Results go to stdout, one line per run.
+#
+#   NS3_DIR=~/ns-allinone-3.35/ns-3.35 ./libra-bench.sh capacity
+
+NS3_DIR=${NS3_DIR:-$HOME/ns-allinone-3.35/ns-3.35}
+SCENARIO=${SCENARIO:-scratch/Wired}
+
+# run_in <scratch program> <args>: one simulation, output on stdout
+run_in ()
+{
+  program=$1
+  shift
+  (cd "$NS3_DIR" && mkdir -p Task_B && ./waf --run "$program $*" 2>&1)
+}
+
+run ()
+{
+  run_in "$SCENARIO" "$@"
+}
+
+# seconds since the epoch, for timing whole commands
+now ()
+{
+  date +%s.%N
+}
+
+# Mean and variance of the queue length column of a .plotme file, after
+# the first three seconds.
+queue_stats ()
+{
+  awk '$1 >= 3 { sum += $2; sq += $2 * $2; n++ }
+    END { m = sum / n; printf "queue mean %.2f variance %.2f packets\n", m, sq / n - m * m }' "$1"
+}
+
+case "$1" in
+  capacity)
+    # Link utilization of the dumbbell at different bottleneck rates; the
+    # access links run at 1Gbps so the point-to-point link is the narrow one.
+    # The standalone model of the same dumbbell runs first and adds the
+    # capacity estimates.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/libra-capacity-bench.cc" \
+      -o /tmp/libra-capacity-bench && /tmp/libra-capacity-bench
+    for rate in 1.5Mbps 10Mbps 100Mbps 1Gbps; do
+      printf "%s\t" "$rate"
+      run --bottleneckRate=$rate --dataRate=1Gbps | grep "Bottleneck utilization"
+    done
+    ;;
+  queue)
+    # Standing queue on the 1.5Mbps RED bottleneck: mean of red-queue.plotme
+    # once the flows are past slow start.
+    run --redTest=1 --traceQueue=true > /dev/null
+    queue_stats "$NS3_DIR/Task_B/red-queue.plotme"
+    ;;
+  rampup)
+    # Time from sender start until the dumbbell first carries 90% of the
+    # bottleneck rate, with a single Bic/Libra pair and with 50 flows.
+    for flow in 2 50; do
+      printf "%s flows\t" "$flow"
+      run --flow=$flow --nCsma=$((flow - 1)) | grep "Time to 90% utilization"
+    done
+    ;;
+  exp)
+    # Penalty factor cost per ACK, std::exp against the table.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/libra-exp-bench.cc" -o /tmp/libra-exp-bench &&
+      /tmp/libra-exp-bench
+    # Resulting cwnd trajectories: mean cwnd of the Libra (odd) flows and
+    # goodput with each variant; cwnd-{exact,table}.txt are kept for plots.
+    for mode in false true; do
+      run --traceCwnd=true --ns3::TcpLibra::TableExp=$mode | grep "Average Goodput"
+      name=exact; [ $mode = true ] && name=table
+      mv "$NS3_DIR/Task_B/cwnd.txt" "$NS3_DIR/Task_B/cwnd-$name.txt"
+      awk -v name=$name '$2 % 2 == 1 { sum += $3; n++ }
+        END { printf "%s mean Libra cwnd %.0f bytes\n", name, sum / n }' "$NS3_DIR/Task_B/cwnd-$name.txt"
+    done
+    ;;
+  cpu)
+    # Wall-clock time of the default 50-flow run; compare across builds of
+    # tcp-libra.cc to see the per-ACK cost of congestion avoidance.
+    for i in 1 2 3; do
+      run | grep "Simulation wall-clock"
+    done
+    ;;
+  core)
+    # Cost of the control law alone, outside ns-3: ns per ACK in congestion
+    # avoidance and per loss event.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/libra-core-bench.cc" \
+      -o /tmp/libra-core-bench && /tmp/libra-core-bench
+    ;;
+  scale)
+    # Per-flow memory and ACK throughput of the core with 10k and 100k
+    # flows, then the memory of whole TcpLibra sockets.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/libra-scale-bench.cc" \
+      -o /tmp/libra-scale-bench && /tmp/libra-scale-bench 10000 100000
+    cp "$dir/libra-socket-scale.cc" "$NS3_DIR/scratch/libra-socket-scale.cc"
+    for flows in 10000 100000; do
+      run_in scratch/libra-socket-scale --flows=$flows | grep -e sizeof -e socket
+    done
+    ;;
+  trace)
+    # Cost of the internals trace sources: standalone per-ACK overhead with
+    # no sink and with the ring buffer sink, then the dumbbell wall-clock
+    # time without and with --traceInternals.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -pthread -I"$dir/.." "$dir/libra-trace-bench.cc" \
+      -o /tmp/libra-trace-bench && /tmp/libra-trace-bench
+    for trace in false true; do
+      printf "traceInternals=%s\t" "$trace"
+      run --traceInternals=$trace | grep "Simulation wall-clock"
+    done
+    ;;
+  replay)
+    # Record the Libra flows of one dumbbell run, then replay the first
+    # trace offline with a few penalty gains; trajectories go to
+    # replay-k2-*.txt.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/libra-replay.cc" -o /tmp/libra-replay || exit 1
+    run --ns3::TcpLibra::TraceFile=Task_B/libra-trace > /dev/null
+    for k2 in 1 2 4; do
+      printf "k2=%s\t" "$k2"
+      /tmp/libra-replay "$NS3_DIR/Task_B/libra-trace-0.bin" --k2=$k2 \
+        --out="$NS3_DIR/Task_B/replay-k2-$k2.txt" | tr '\n' ' '
+      echo
+    done
+    ;;
+  fixed)
+    # Fixed-point against double-precision window updates: divergence over
+    # the generated steady and loss-heavy traces, then over the Libra flows
+    # recorded from one dumbbell run, then both laws on the dumbbell.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/libra-fixed-point-bench.cc" \
+      -o /tmp/libra-fixed-point-bench && /tmp/libra-fixed-point-bench
+    run --ns3::TcpLibra::TraceFile=Task_B/libra-trace > /dev/null
+    /tmp/libra-fixed-point-bench "$NS3_DIR"/Task_B/libra-trace-*.bin
+    for mode in false true; do
+      printf "FixedPoint=%s\t" "$mode"
+      run --ns3::TcpLibra::FixedPoint=$mode | grep "Bottleneck utilization"
+    done
+    ;;
+  pacing)
+    # Queue-delay variance (from the queue samples) and loss (flowmon.py)
+    # with and without Libra pacing, on the dumbbell and on the hybrid
+    # topology (Task-A-Code/hybrid.cc copied to scratch/hybrid.cc).
+    dir=$(cd "$(dirname "$0")/.." && pwd)
+    mkdir -p "$NS3_DIR/Task_A" "$NS3_DIR/lastFiles"
+    for pacing in false true; do
+      echo "pacing=$pacing"
+      run --redTest=1 --traceQueue=true --pacing=$pacing > /dev/null
+      queue_stats "$NS3_DIR/Task_B/red-queue.plotme"
+      python3 "$dir/flowmon.py" "$NS3_DIR/Task_B/fullwired.flowmonitor" | grep "Drop Ratio"
+      run_in scratch/hybrid --redTest=1 --tcpVariant=TcpLibra --pacing=$pacing > /dev/null
+      queue_stats "$NS3_DIR/Task_A/red-queue.plotme"
+      python3 "$dir/flowmon.py" "$NS3_DIR/Task_A/hybrid.flowmonitor" | grep "Drop Ratio"
+    done
+    ;;
+  hystart)
+    # Startup: drops at the bottleneck during the first two seconds and the
+    # time to reach 90% utilization, with and without HyStart.
+    for hystart in false true; do
+      echo "HyStart=$hystart"
+      run --simulationTime=2 --ns3::TcpLibra::HyStart=$hystart |
+        grep -e "Bottleneck drops" -e "Time to 90% utilization"
+    done
+    ;;
+  ecn)
+    # Goodput, drops, marks and retransmissions with RED dropping and with
+    # RED marking, on the dumbbell and on the hybrid topology.
+    mkdir -p "$NS3_DIR/Task_A" "$NS3_DIR/lastFiles"
+    for ecn in false true; do
+      echo "ecn=$ecn"
+      run --redTest=1 --ecn=$ecn |
+        grep -e "Average Goodput" -e "Bottleneck" -e "Lost packets"
+      run_in scratch/hybrid --redTest=1 --tcpVariant=TcpLibra --ecn=$ecn |
+        grep -e "Average Goodput" -e "Bottleneck" -e "Lost packets"
+    done
+    ;;
+  applimited)
+    # OnOff senders busy 100ms out of every 500ms at half the bottleneck
+    # rate: largest cwnd of the Libra flows (odd flow ids in cwnd.txt) and
+    # goodput, with and without the rate sample app-limited guard.
+    for rateSample in false true; do
+      printf "RateSample=%s\t" "$rateSample"
+      run --flow=2 --nCsma=1 --bottleneckRate=10Mbps --dataRate=100Mbps --appRate=5Mbps \
+        --onTime=0.1 --offTime=0.4 --traceCwnd=true --rateSample=$rateSample | grep "Average Goodput" |
+        tr '\n' '\t'
+      awk '$2 % 2 == 1 && $3 > max { max = $3 } END { printf "max Libra cwnd %d bytes\n", max }' \
+        "$NS3_DIR/Task_B/cwnd.txt"
+    done
+    ;;
+  fct)
+    # Completion time of 10-500KB flows run one after the other from one
+    # TcpLibra sender, starting cold and from the node's metrics cache.
+    for metricsCache in false true; do
+      echo "MetricsCache=$metricsCache"
+      run --flow=2 --nCsma=1 --fctFlows=50 --metricsCache=$metricsCache | grep "FCT"
+    done
+    ;;
+  lossdiff)
+    # Aggregate goodput of TcpLibra without and with loss differentiation,
+    # over packet error rates and wifi ranges on the hybrid topology and
+    # over error rates on the LR-WPAN one.
+    mkdir -p "$NS3_DIR/Task_A" "$NS3_DIR/lastFiles"
+    for range in 20 100 200; do
+      for rate in 0 0.01 0.05 0.1 0.2; do
+        for lossDiff in false true; do
+          printf "hybrid range=%s errorRate=%s lossDiff=%s\t" "$range" "$rate" "$lossDiff"
+          run_in scratch/hybrid --tcpVariant=TcpLibra --range=$range --errorRate=$rate \
+            --lossDiff=$lossDiff | grep "Aggregate Goodput"
+        done
+      done
+    done
+    for rate in 0 0.01 0.05 0.1; do
+      for lossDiff in false true; do
+        printf "lowrate errorRate=%s lossDiff=%s\t" "$rate" "$lossDiff"
+        run_in scratch/wireless_low_rate_static --tcpVariant=ns3::TcpLibra --errorRate=$rate \
+          --lossDiff=$lossDiff | grep "Aggregate Goodput"
+      done
+    done
+    ;;
+  recovery)
+    # Goodput and fast recovery duration on the 50-flow dumbbell under burst
+    # loss, with the per-duplicate-ACK decrease and with PRR, with SACK.
+    for prr in false true; do
+      echo "Prr=$prr"
+      run --burstErrorRate=0.001 --burstSize=5 --traceRecovery=true --ns3::TcpLibra::Prr=$prr |
+        grep -e "Bottleneck utilization" -e "Recovery episodes"
+    done
+    ;;
+  coupled)
+    # The 50-flow dumbbell with the TcpLibra flows sent between one pair of
+    # hosts, uncoupled and coupled into one group: queue length, drops and
+    # Jain's index.
+    for coupled in false true; do
+      echo "coupled=$coupled"
+      run --traceQueue=true --sharedHost=true --coupled=$coupled |
+        grep -e "Bottleneck utilization" -e "Bottleneck drops" -e "Jain's index"
+      queue_stats "$NS3_DIR/Task_B/red-queue.plotme"
+    done
+    ;;
+  target)
+    # p50/p99 RTT of the TcpLibra flows and utilization, default Libra
+    # against a 5ms queuing delay target, on the RED and DropTail bottlenecks.
+    for dropTail in false true; do
+      for target in 0ms 5ms; do
+        echo "dropTail=$dropTail TargetDelay=$target"
+        run --dropTail=$dropTail --traceRtt=true --ns3::TcpLibra::TargetDelay=$target |
+          grep -e "Bottleneck utilization" -e "TcpLibra RTT"
+      done
+    done
+    ;;
+  monitor)
+    # Cost of the queue length log: standalone per-sample cost of reopening
+    # the .plotme files against the buffered text and binary writers, then
+    # the wall-clock time of a 100s dumbbell run without a queue log, with
+    # 10ms samples as text and as binary, and with every length change.
+    dir=$(dirname "$0")
+    ${CXX:-g++} -O2 -std=c++17 -I"$dir/.." "$dir/queue-monitor-bench.cc" \
+      -o /tmp/queue-monitor-bench && /tmp/queue-monitor-bench
+    for log in "--traceQueue=false" "--traceQueue=true" "--traceQueue=true --queueBinary=true" \
+      "--traceQueueEvents=true --queueBinary=true"; do
+      printf "%s\t" "$log"
+      run --simulationTime=100 $log | grep "Simulation wall-clock"
+    done
+    ;;
+  flowstats)
+    # The flow statistics Wired.cc prints against flowmon.py and Fairness.py
+    # on the XML of the same run, which must be identical; then the time of
+    # a run with and without the XML dump, and of the two scripts.
+    dir=$(cd "$(dirname "$0")/.." && pwd)
+    xml="$NS3_DIR/Task_B/fullwired.flowmonitor"
+    start=$(now)
+    run > /tmp/libra-flowstats-run.txt
+    end=$(now)
+    sed -n '/^Througput Calculation/,/^Jain.s Index for Libra/p' /tmp/libra-flowstats-run.txt \
+      > /tmp/libra-flowstats-cxx.txt
+    pystart=$(now)
+    { python3 "$dir/flowmon.py" "$xml" && python3 "$dir/Fairness.py" "$xml"; } |
+      sed -n '/^Througput Calculation/,$p' > /tmp/libra-flowstats-py.txt
+    pyend=$(now)
+    if diff /tmp/libra-flowstats-py.txt /tmp/libra-flowstats-cxx.txt; then
+      echo "flow statistics identical to flowmon.py and Fairness.py"
+    fi
+    start2=$(now)
+    run --flowXml=false > /dev/null
+    end2=$(now)
+    awk -v a="$start" -v b="$end" -v c="$pystart" -v d="$pyend" -v e="$start2" -v f="$end2" \
+      'BEGIN { printf "run with XML %.2f s, scripts %.2f s, run without XML %.2f s\n",
+        b - a, d - c, f - e }'
+    ;;
+  delack)
+    # Ramp-up, utilization and RTT of a single Bic/Libra pair and goodput on
+    # the hybrid topology with 1, 2 and 8 segments per delayed ACK. The
+    # defaults grow by one ACK's worth whatever the ACK covers, in slow
+    # start and congestion avoidance alike; then byte counting alone, then
+    # byte counting with the ACK filter.
+    mkdir -p "$NS3_DIR/Task_A" "$NS3_DIR/lastFiles"
+    for count in 1 2 8; do
+      for abc in "1 false false" "2 true false" "2 true true"; do
+        set -- $abc
+        echo "DelAckCount=$count AbcLimit=$1 ByteCounting=$2 AckFilter=$3"
+        libra="--ns3::TcpLibra::AbcLimit=$1 --ns3::TcpLibra::ByteCounting=$2"
+        libra="$libra --ns3::TcpLibra::AckFilter=$3"
+        run --flow=2 --nCsma=1 --traceRtt=true --ns3::TcpSocket::DelAckCount=$count $libra |
+          grep -e "Time to 90% utilization" -e "Bottleneck utilization" -e "TcpLibra RTT"
+        run_in scratch/hybrid --tcpVariant=TcpLibra --ns3::TcpSocket::DelAckCount=$count \
+          $libra | grep "Aggregate Goodput"
+      done
+    done
+    ;;
+  scn)
+    # The scenario files against the mains they stand for: each main and
+    # its file in scenario/configs run with default parameters, and the
+    # summary lines the main prints are diffed against the same lines of
+    # the engine's summary.txt. Exits 1 if any file differs.
+    src=$(cd "$(dirname "$0")/.." && pwd)
+    mkdir -p "$NS3_DIR/scratch/scenario" "$NS3_DIR/Task_A" "$NS3_DIR/lastFiles"
+    cp "$src/scenario/scenario.cc" "$src/scenario/scenario-config.h" \
+      "$src/scenario/scenario-config.cc" "$NS3_DIR/scratch/scenario/"
+    cp "$src/../Task-A-Code/Wired.cc" "$NS3_DIR/scratch/wired_a.cc"
+    cp "$src/../Task-A-Code/hybrid.cc" "$src/../Task-A-Code/wireless_low_rate_static.cc" \
+      "$NS3_DIR/scratch/"
+    cp "$src/Wired.cc" "$NS3_DIR/scratch/Wired.cc"
+    labels='^(Average Goodput|Aggregate Goodput|Bottleneck utilization|Bottleneck drops|Bottleneck ECN marks|Lost packets)'
+    status=0
+    for pair in wired_a:wired-a Wired:wired-b hybrid:hybrid wireless_low_rate_static:low-rate; do
+      main=${pair%%:*}
+      scn=${pair#*:}
+      out=/tmp/libra-scn-$scn
+      mkdir -p "$out"
+      run_in scratch/$main | grep -E "$labels" > "$out/main.txt"
+      run_in scratch/scenario --config="$src/scenario/configs/$scn.scn" --runDir="$out" > /dev/null
+      awk -F: 'NR == FNR { want[$1]; next } $1 in want' "$out/main.txt" "$out/summary.txt" \
+        > "$out/scn.txt"
+      if [ ! -s "$out/main.txt" ]; then
+        echo "$scn.scn: no summary from scratch/$main"
+        status=1
+      elif diff "$out/main.txt" "$out/scn.txt" > "$out/diff.txt"; then
+        echo "$scn.scn: matches scratch/$main ($(wc -l < "$out/main.txt") lines)"
+      else
+        echo "$scn.scn: differs from scratch/$main"
+        cat "$out/diff.txt"
+        status=1
+      fi
+    done
+    exit $status
+    ;;
+  *)
+    echo "usage: $0 capacity|queue|rampup|exp|cpu|core|trace|replay|fixed|pacing|hystart|ecn|applimited|fct|lossdiff|recovery|coupled|target|delack|scale|monitor|flowstats|scn" >&2
+    exit 1
+    ;;
+esac
@@ -0,0 +1,394 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Capacity estimate and link utilization of TcpLibraCore on the Wired.cc
+ * dumbbell, without ns-3: 50 flows start together after 1s, share a
+ * 1Gbps LAN into a point-to-point bottleneck with 10ms delay and a
+ * 1000-packet FIFO, and run for 10s with 1000-byte segments and delayed
+ * ACKs every second segment, as in
+ *
+ *   ./waf --run "scratch/Wired --bottleneckRate=<rate> --dataRate=1Gbps --dropTail=true"
+ *
+ * The senders drive the shipped core as TcpLibra does: new data goes to
+ * OnSend, ACKs in Open to UpdateCapacityEstimate, a loss resets the probe
+ * and takes the Libra decrease once per window. Losses are detected one
+ * RTT after the drop, as with SACK, and recovery sends within cwnd.
+ *
+ * For each bottleneck rate it reports the utilization over the 10s, the
+ * median over the flows of their packet-pair capacity estimate, and, on
+ * the same ACK stream, the median of the estimate that took every gap
+ * between two ACKs as a sample. With equal RTTs each flow's window
+ * crosses the FIFO as one train and both estimates hold; the runs are
+ * repeated with RTTs spread over 10ms more, where the trains break up,
+ * the other flows' segments sit between two ACK-clocked segments of one
+ * flow, and the ACK gap estimate falls toward the flow's own share.
+ *
+ * Standalone, no ns-3 needed:
+ *
+ *   g++ -O2 -std=c++17 -I.. libra-capacity-bench.cc -o libra-capacity-bench
+ *   ./libra-capacity-bench [flows] [rate in bit/s...]
+ *
+ * Payload over wire bytes caps both the utilization and the estimates at
+ * 0.949 C.
+ */
+
+#include "tcp-libra-core.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <queue>
+#include <set>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+const uint32_t segmentSize = 1000;
+const double packetBits = (segmentSize + 54) * 8.0;  // TCP/IP and Ethernet headers
+const double lanRate = 1e9;                          // bit/s
+const double lanDelay = 6.56e-6;                     // s
+const double bottleneckDelay = 0.01;                 // s
+const size_t bufferPackets = 1000;
+const double startTime = 1.0;                        // s
+const double stopTime = 11.0;                        // s
+const uint32_t delAckCount = 2;
+const double delAckTimeout = 0.2;                    // s
+const uint32_t initialCwnd = 10 * segmentSize;
+const uint32_t abcLimit = 2;                         // segments
+
+/// The estimate TcpLibra took before packet-pair probes: any two ACKs
+class AckGapEstimate
+{
+public:
+  AckGapEstimate () : m_lastAck (-1.0), m_capacity (0.0) {}
+
+  void Update (double now, uint32_t segmentsAcked, uint32_t bytesInFlight, double baseRtt)
+  {
+    double spacing = now - m_lastAck;
+    bool first = m_lastAck < 0.0;
+    m_lastAck = now;
+    if (first || segmentsAcked == 0 || !(spacing > 0.0) || spacing > baseRtt
+        || bytesInFlight < 2 * segmentSize)
+      {
+        return;
+      }
+    m_samples.push_back (segmentsAcked * segmentSize / spacing);
+    if (m_samples.size () > 15)
+      {
+        m_samples.pop_front ();
+      }
+    std::vector<double> sorted (m_samples.begin (), m_samples.end ());
+    std::nth_element (sorted.begin (), sorted.begin () + sorted.size () / 2, sorted.end ());
+    m_capacity = sorted[sorted.size () / 2];
+  }
+
+  double GetCapacity () const { return m_capacity; }
+
+private:
+  double m_lastAck;
+  std::deque<double> m_samples;
+  double m_capacity;
+};
+
+struct Flow
+{
+  // Sender, in segments
+  TcpLibraCore<uint32_t, double> core;
+  AckGapEstimate ackGap;
+  uint32_t cWnd = initialCwnd;
+  uint32_t ssThresh = UINT32_MAX;
+  uint32_t nextSeg = 0;
+  uint32_t sndUna = 0;
+  uint32_t pipe = 0;
+  bool recovery = false;
+  uint32_t recover = 0;
+  std::deque<uint32_t> retransmit;
+  // Receiver
+  uint32_t expected = 0;
+  std::set<uint32_t> outOfOrder;
+  uint32_t pendingAcks = 0;
+  uint32_t arrived = 0;
+  uint32_t delAckGen = 0;
+  uint64_t rxBytes = 0;
+};
+
+struct Event
+{
+  enum Type { START, RECEIVE, ACK, LOSS, DELACK };
+
+  double time;
+  uint64_t order;
+  Type type;
+  uint32_t flow;
+  uint32_t a;     //!< Segment, cumulative ACK or timer generation
+  uint32_t b;     //!< Segments delivered by an ACK
+  double sent;    //!< Send time of the segment, echoed by its ACK
+
+  bool operator> (const Event &o) const
+  {
+    return time > o.time || (time == o.time && order > o.order);
+  }
+};
+
+uint32_t
+Us (double s)
+{
+  return static_cast<uint32_t> (s * 1e6);
+}
+
+class Dumbbell
+{
+public:
+  Dumbbell (size_t flows, double rate, double rttSpread)
+    : m_flows (flows),
+      m_rate (rate),
+      m_rttSpread (rttSpread),
+      m_lanFree (0.0),
+      m_bottleneckFree (0.0),
+      m_order (0),
+      m_drops (0)
+  {
+  }
+
+  void Run ()
+  {
+    for (uint32_t i = 0; i < m_flows.size (); ++i)
+      {
+        Schedule ({startTime, 0, Event::START, i, 0, 0, 0.0});
+      }
+    while (!m_events.empty () && m_events.top ().time < stopTime)
+      {
+        Event e = m_events.top ();
+        m_events.pop ();
+        Flow &flow = m_flows[e.flow];
+        switch (e.type)
+          {
+          case Event::RECEIVE:
+            Receive (e, flow);
+            break;
+          case Event::ACK:
+            Ack (e, flow);
+            break;
+          case Event::LOSS:
+            Loss (e, flow);
+            break;
+          case Event::START:
+            Send (e.time, e.flow, flow);
+            break;
+          case Event::DELACK:
+            if (e.a == flow.delAckGen && flow.pendingAcks > 0)
+              {
+                SendAck (e.time, e.flow, flow, e.sent);
+              }
+            break;
+          }
+      }
+  }
+
+  void Report () const
+  {
+    uint64_t rx = 0;
+    std::vector<double> pair;
+    std::vector<double> gap;
+    size_t estimated = 0;
+    for (const Flow &flow : m_flows)
+      {
+        rx += flow.rxBytes;
+        estimated += flow.core.GetCapacity () > 0.0;
+        pair.push_back (flow.core.GetCapacity ());
+        gap.push_back (flow.ackGap.GetCapacity ());
+      }
+    std::sort (pair.begin (), pair.end ());
+    std::sort (gap.begin (), gap.end ());
+    double capacity = m_rate / 8;
+    std::printf ("%8.4g Mbps  utilization %5.1f%%  pair estimate %6.3f C (%zu/%zu flows)  "
+                 "ack gap estimate %6.3f C  drops %llu\n",
+                 m_rate / 1e6, 100.0 * rx * 8 / (m_rate * (stopTime - startTime)),
+                 pair[pair.size () / 2] / capacity, estimated, m_flows.size (),
+                 gap[gap.size () / 2] / capacity, static_cast<unsigned long long> (m_drops));
+  }
+
+private:
+  void Schedule (Event e)
+  {
+    e.order = m_order++;
+    m_events.push (e);
+  }
+
+  /// Put one segment on the LAN and through the bottleneck FIFO
+  void Transmit (double now, uint32_t id, uint32_t seg)
+  {
+    // One LAN and one FIFO, so segments keep their send order throughout
+    m_lanFree = std::max (now, m_lanFree) + packetBits / lanRate;
+    double arrive = m_lanFree + lanDelay;
+    while (!m_queue.empty () && m_queue.front () <= arrive)
+      {
+        m_queue.pop_front ();
+      }
+    if (m_queue.size () >= bufferPackets)
+      {
+        ++m_drops;
+        // Known once the segments behind it are acked, as with SACK
+        double queueDelay = std::max (0.0, m_bottleneckFree - arrive);
+        Schedule ({arrive + queueDelay + 2 * bottleneckDelay + 4 * lanDelay, 0, Event::LOSS, id,
+                   seg, 0, now});
+        return;
+      }
+    m_bottleneckFree = std::max (arrive, m_bottleneckFree) + packetBits / m_rate;
+    m_queue.push_back (m_bottleneckFree);
+    Schedule ({m_bottleneckFree + bottleneckDelay + packetBits / lanRate + lanDelay, 0,
+               Event::RECEIVE, id, seg, 0, now});
+  }
+
+  void Send (double now, uint32_t id, Flow &flow)
+  {
+    while ((flow.pipe + 1) * segmentSize <= flow.cWnd)
+      {
+        if (!flow.retransmit.empty ())
+          {
+            Transmit (now, id, flow.retransmit.front ());
+            flow.retransmit.pop_front ();
+          }
+        else
+          {
+            flow.core.OnSend (Us (now), flow.nextSeg * segmentSize,
+                              (flow.nextSeg + 1) * segmentSize);
+            Transmit (now, id, flow.nextSeg++);
+          }
+        ++flow.pipe;
+      }
+  }
+
+  void Receive (const Event &e, Flow &flow)
+  {
+    ++flow.arrived;
+    bool immediate = !flow.outOfOrder.empty ();
+    if (e.a == flow.expected)
+      {
+        uint32_t from = flow.expected++;
+        while (!flow.outOfOrder.empty () && *flow.outOfOrder.begin () == flow.expected)
+          {
+            flow.outOfOrder.erase (flow.outOfOrder.begin ());
+            ++flow.expected;
+          }
+        flow.rxBytes += (flow.expected - from) * segmentSize;
+      }
+    else
+      {
+        if (e.a > flow.expected)
+          {
+            flow.outOfOrder.insert (e.a);
+          }
+        immediate = true;
+      }
+    if (immediate || ++flow.pendingAcks >= delAckCount)
+      {
+        SendAck (e.time, e.flow, flow, e.sent);
+      }
+    else
+      {
+        Schedule ({e.time + delAckTimeout, 0, Event::DELACK, e.flow, flow.delAckGen, 0, e.sent});
+      }
+  }
+
+  void SendAck (double now, uint32_t id, Flow &flow, double sent)
+  {
+    double spread = m_rttSpread * id / m_flows.size ();
+    Schedule ({now + bottleneckDelay + 2 * lanDelay + spread, 0, Event::ACK, id, flow.expected,
+               flow.arrived, sent});
+    flow.pendingAcks = 0;
+    flow.arrived = 0;
+    ++flow.delAckGen;
+  }
+
+  void Ack (const Event &e, Flow &flow)
+  {
+    flow.pipe -= std::min (flow.pipe, e.b);
+    if (e.a > flow.sndUna)
+      {
+        uint32_t segmentsAcked = e.a - flow.sndUna;
+        flow.sndUna = e.a;
+        if (flow.recovery && flow.sndUna >= flow.recover)
+          {
+            flow.recovery = false;
+            flow.cWnd = flow.ssThresh;
+          }
+        if (!flow.recovery)
+          {
+            uint32_t now = Us (e.time);
+            flow.core.UpdateCapacityEstimate (now, flow.sndUna * segmentSize);
+            flow.ackGap.Update (e.time, segmentsAcked, flow.pipe * segmentSize,
+                                flow.core.GetBaseRtt () * 1e-6);
+            flow.core.UpdateRound (flow.sndUna * segmentSize, flow.nextSeg * segmentSize);
+            flow.core.UpdateRtt (std::max<uint32_t> (Us (e.time - e.sent), 1));
+            if (flow.cWnd < flow.ssThresh)
+              {
+                flow.cWnd += std::min (segmentsAcked, abcLimit) * segmentSize;
+              }
+            else
+              {
+                flow.cWnd = flow.core.IncreaseWindow (flow.cWnd, flow.cWnd, segmentsAcked);
+              }
+          }
+      }
+    Send (e.time, e.flow, flow);
+  }
+
+  void Loss (const Event &e, Flow &flow)
+  {
+    flow.pipe -= std::min<uint32_t> (flow.pipe, 1);
+    flow.retransmit.push_back (e.a);
+    if (!flow.recovery)
+      {
+        flow.recovery = true;
+        flow.recover = flow.nextSeg;
+        flow.ssThresh = std::max ({flow.core.ComputeDecrease (flow.cWnd),
+                                   flow.pipe * segmentSize / 2, 2 * segmentSize});
+        flow.cWnd = flow.ssThresh;
+        flow.core.ResetCapacityProbe ();
+      }
+    Send (e.time, e.flow, flow);
+  }
+
+  std::vector<Flow> m_flows;
+  double m_rate;
+  double m_rttSpread;          //!< Extra ACK path delay of the last flow (s)
+  double m_lanFree;
+  double m_bottleneckFree;
+  std::deque<double> m_queue;  //!< Departure times of the segments in the FIFO
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+  uint64_t m_order;
+  uint64_t m_drops;
+};
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  size_t flows = argc > 1 ? std::strtoul (argv[1], nullptr, 10) : 50;
+  std::vector<double> rates;
+  for (int i = 2; i < argc; ++i)
+    {
+      rates.push_back (std::atof (argv[i]));
+    }
+  if (rates.empty ())
+    {
+      rates = {1.5e6, 10e6, 100e6, 1e9};
+    }
+
+  for (double spread : {0.0, 0.01})
+    {
+      std::printf ("%zu flows, RTTs spread over %g ms more, C = bottleneck rate\n", flows,
+                   spread * 1e3);
+      for (double rate : rates)
+        {
+          Dumbbell dumbbell (flows, rate, spread);
+          dumbbell.Run ();
+          dumbbell.Report ();
+        }
+    }
+  return 0;
+}
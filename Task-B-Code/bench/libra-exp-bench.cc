@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Microbenchmark of the TcpLibra penalty factor: std::exp against
+ * TcpLibraExpTable. Reports the maximum error of the table over its range
+ * and the cost of one penalty evaluation, which TcpLibra does once per ACK
+ * in congestion avoidance.
+ *
+ * Standalone, no ns-3 needed:
+ *
+ *   g++ -O2 -std=c++17 -I.. libra-exp-bench.cc -o libra-exp-bench
+ *   ./libra-exp-bench
+ */
+
+#include "tcp-libra-exp-table.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+const double k2 = 2.0;
+
+double
+PenaltyExact (double qavg, double qmax)
+{
+  return std::exp (-k2 * qavg / qmax);
+}
+
+double
+PenaltyTable (double qavg, double qmax)
+{
+  return TcpLibraExpTable::ExpNeg (k2 * qavg / qmax);
+}
+
+template <typename F>
+double
+NsPerCall (F penalty, const std::vector<double> &qavg, const std::vector<double> &qmax,
+           double *sink)
+{
+  const int reps = 20;
+  double sum = 0.0;
+  auto start = std::chrono::steady_clock::now ();
+  for (int r = 0; r < reps; ++r)
+    {
+      for (size_t i = 0; i < qavg.size (); ++i)
+        {
+          sum += penalty (qavg[i], qmax[i]);
+        }
+    }
+  auto stop = std::chrono::steady_clock::now ();
+  *sink += sum;
+  return std::chrono::duration<double, std::nano> (stop - start).count () / (reps * qavg.size ());
+}
+
+} // namespace
+
+int
+main ()
+{
+  double maxAbs = 0.0;
+  double maxRel = 0.0;
+  const double range = TcpLibraExpTable::Range;
+  for (double x = 0.0; x < range; x += 1e-5)
+    {
+      double exact = std::exp (-x);
+      double err = std::fabs (TcpLibraExpTable::ExpNeg (x) - exact);
+      maxAbs = std::max (maxAbs, err);
+      maxRel = std::max (maxRel, err / exact);
+    }
+  std::printf ("table range [0, %g), step 1/%u\n", range, TcpLibraExpTable::Steps);
+  std::printf ("max abs error %.3e, max rel error %.3e\n", maxAbs, maxRel);
+
+  // Backlog samples as TcpLibra sees them: Qavg within [0, Qmax].
+  std::mt19937 rng (1);
+  std::uniform_real_distribution<double> ms (0.1, 50.0);
+  std::uniform_real_distribution<double> share (0.0, 1.0);
+  std::vector<double> qavg (1 << 20);
+  std::vector<double> qmax (qavg.size ());
+  for (size_t i = 0; i < qavg.size (); ++i)
+    {
+      qmax[i] = ms (rng) * 1e-3;
+      qavg[i] = share (rng) * qmax[i];
+    }
+
+  double sink = 0.0;
+  double exact = NsPerCall (PenaltyExact, qavg, qmax, &sink);
+  double table = NsPerCall (PenaltyTable, qavg, qmax, &sink);
+  std::printf ("penalty std::exp  %.2f ns/ACK\n", exact);
+  std::printf ("penalty table     %.2f ns/ACK\n", table);
+  std::printf ("(checksum %g)\n", sink);
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Offline replay of TcpLibra ACK traces.
+ *
+ * TcpLibra records a trace when its TraceFile attribute is set: one
+ * 12-byte record per PktsAcked, IncreaseWindow, HandleWindowForDupAck and
+ * GetSsThresh call, plus HyStart exits and new data sent (see
+ * tcp-libra-trace.h). This tool maps the trace and drives TcpLibraCore
+ * through the same calls in the same order, with no event scheduler, so
+ * changes to k1, k2, T0 and T1 can be tried in seconds instead of a full
+ * Wired.cc run.
+ *
+ * The trace carries the socket's calls, not its state, so the replay
+ * keeps its own: the sent and acked sequences advance by the segments of
+ * each send and PktsAcked, bytes in flight are taken to be cwnd, and after
+ * GetSsThresh cwnd drops to the new ssthresh, as recovery leaves it; the
+ * capacity estimate skips ACKs until everything sent by then is acked.
+ * Version 1 traces have no sends, so the replay sends up to the acked
+ * sequence plus cwnd after each PktsAcked. Once the control law differs
+ * from the recorded one, the replay is open loop: the ACK clock and RTTs
+ * stay those of the recording.
+ *
+ * Standalone, no ns-3 needed:
+ *
+ *   g++ -O2 -std=c++17 -I.. libra-replay.cc -o libra-replay
+ *   ./libra-replay trace.bin [--k1=2] [--k2=2] [--t0=1] [--t1=1]
+ *                  [--fixed-point] [--table-exp] [--out=cwnd.txt]
+ *   ./libra-replay --generate=trace.bin [acks]
+ *
+ * The output has one line per RTT round and per congestion event:
+ * time (s), cwnd (bytes), ssthresh (bytes), alpha.
+ */
+
+#include "libra-replay.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace ns3;
+
+namespace {
+
+bool
+ParseDouble (const char *arg, const char *name, double *value)
+{
+  size_t len = std::strlen (name);
+  if (std::strncmp (arg, name, len) != 0)
+    {
+      return false;
+    }
+  *value = std::atof (arg + len);
+  return true;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      std::fprintf (stderr, "usage: %s trace.bin [--k1=X] [--k2=X] [--t0=S] [--t1=S] "
+                    "[--fixed-point] [--table-exp] [--out=file]\n"
+                    "       %s --generate=trace.bin [acks]\n", argv[0], argv[0]);
+      return 1;
+    }
+  if (std::strncmp (argv[1], "--generate=", 11) == 0)
+    {
+      size_t acks = argc > 2 ? std::strtoul (argv[2], nullptr, 10) : 10000000;
+      return TcpLibraGenerateTrace (argv[1] + 11, acks);
+    }
+
+  TcpLibraReplayOptions options;
+  for (int i = 2; i < argc; ++i)
+    {
+      const char *arg = argv[i];
+      if (ParseDouble (arg, "--k1=", &options.k1) || ParseDouble (arg, "--k2=", &options.k2)
+          || ParseDouble (arg, "--t0=", &options.t0) || ParseDouble (arg, "--t1=", &options.t1))
+        {
+          continue;
+        }
+      if (std::strcmp (arg, "--fixed-point") == 0)
+        {
+          options.fixedPoint = true;
+        }
+      else if (std::strcmp (arg, "--table-exp") == 0)
+        {
+          options.tableExp = true;
+        }
+      else if (std::strncmp (arg, "--out=", 6) == 0)
+        {
+          options.out = arg + 6;
+        }
+      else
+        {
+          std::fprintf (stderr, "unknown option %s\n", arg);
+          return 1;
+        }
+    }
+
+  TcpLibraMappedTrace trace;
+  if (!trace.Open (argv[1]))
+    {
+      return 1;
+    }
+
+  std::FILE *out = nullptr;
+  if (options.out != nullptr)
+    {
+      out = std::fopen (options.out, "w");
+      if (out == nullptr)
+        {
+          std::perror (options.out);
+          return 1;
+        }
+    }
+
+  TcpLibraReplayer replayer (*trace.Header (), options, out);
+  const TcpLibraTraceRecord *records = trace.Records ();
+  size_t count = trace.Count ();
+
+  auto start = std::chrono::steady_clock::now ();
+  for (size_t i = 0; i < count; ++i)
+    {
+      replayer.Replay (records[i]);
+    }
+  auto stop = std::chrono::steady_clock::now ();
+  if (out != nullptr)
+    {
+      std::fclose (out);
+    }
+
+  double seconds = std::chrono::duration<double> (stop - start).count ();
+  std::printf ("%zu records in %.3f s, %.1f M records/s\n", count, seconds, count / seconds / 1e6);
+  std::printf ("final cwnd %u bytes, mean cwnd %.0f bytes, alpha %.6g, capacity %.6g B/s\n",
+               replayer.GetCwnd (), replayer.GetMeanCwnd (), replayer.GetAlpha (),
+               replayer.GetCapacity ());
+  return 0;
+}
@@ -0,0 +1,361 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Reading, replaying and generating TcpLibra ACK traces (see
+ * tcp-libra-trace.h), shared by libra-replay.cc and
+ * libra-fixed-point-bench.cc. Standalone, no ns-3 needed.
+ */
+#ifndef LIBRA_REPLAY_H
+#define LIBRA_REPLAY_H
+
+#include "tcp-libra-core.h"
+#include "tcp-libra-trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+/// A trace file mapped read-only
+class TcpLibraMappedTrace
+{
+public:
+  TcpLibraMappedTrace () : m_data (nullptr), m_size (0) {}
+  ~TcpLibraMappedTrace ()
+  {
+    if (m_data != nullptr)
+      {
+        munmap (m_data, m_size);
+      }
+  }
+
+  bool Open (const char *path)
+  {
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+      {
+        std::perror (path);
+        return false;
+      }
+    struct stat st;
+    if (fstat (fd, &st) < 0 || static_cast<size_t> (st.st_size) < sizeof (TcpLibraTraceHeader))
+      {
+        std::fprintf (stderr, "%s: not a TcpLibra trace\n", path);
+        close (fd);
+        return false;
+      }
+    m_size = st.st_size;
+    m_data = mmap (nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (m_data == MAP_FAILED)
+      {
+        m_data = nullptr;
+        std::perror (path);
+        return false;
+      }
+    madvise (m_data, m_size, MADV_SEQUENTIAL);
+
+    const TcpLibraTraceHeader *header = Header ();
+    if (std::memcmp (header->magic, "LBRT", 4) != 0
+        || (header->version != 1 && header->version != 2)
+        || header->recordSize != sizeof (TcpLibraTraceRecord))
+      {
+        std::fprintf (stderr, "%s: unsupported trace format\n", path);
+        return false;
+      }
+    return true;
+  }
+
+  const TcpLibraTraceHeader *Header () const
+  {
+    return static_cast<const TcpLibraTraceHeader *> (m_data);
+  }
+  const TcpLibraTraceRecord *Records () const
+  {
+    return reinterpret_cast<const TcpLibraTraceRecord *> (Header () + 1);
+  }
+  size_t Count () const
+  {
+    return (m_size - sizeof (TcpLibraTraceHeader)) / sizeof (TcpLibraTraceRecord);
+  }
+
+private:
+  void *m_data;
+  size_t m_size;
+};
+
+struct TcpLibraReplayOptions
+{
+  double k1 = 2.0;
+  double k2 = 2.0;
+  double t0 = 1.0;
+  double t1 = 1.0;
+  bool fixedPoint = false;
+  bool tableExp = false;
+  const char *out = nullptr;
+};
+
+/// TcpLibra's socket-facing logic over TcpLibraCore, as in tcp-libra.cc
+class TcpLibraReplayer
+{
+public:
+  TcpLibraReplayer (const TcpLibraTraceHeader &header, const TcpLibraReplayOptions &options,
+                    std::FILE *out)
+    : m_segmentSize (header.segmentSize),
+      m_cWnd (header.initialCwnd),
+      m_ssThresh (header.initialSsThresh),
+      m_ackedSeq (0),
+      m_sentSeq (0),
+      m_recover (0),
+      m_recovery (false),
+      m_episodeDecrease (false),
+      m_recordsSends (header.version >= 2),
+      m_out (out),
+      m_cWndSum (0),
+      m_cWndSamples (0)
+  {
+    m_core.SetK1 (options.k1);
+    m_core.SetK2 (options.k2);
+    m_core.SetT0 (options.t0);
+    m_core.SetT1 (options.t1);
+    m_core.SetFixedPoint (options.fixedPoint);
+    m_core.SetTableExp (options.tableExp);
+  }
+
+  void Replay (const TcpLibraTraceRecord &r)
+  {
+    int64_t now = r.timeUs;
+    switch (r.event)
+      {
+      case TcpLibraTraceRecord::SEND:
+        Send (now, m_sentSeq + r.segmentsAcked * m_segmentSize);
+        break;
+      case TcpLibraTraceRecord::PKTS_ACKED:
+        m_ackedSeq += r.segmentsAcked * m_segmentSize;
+        // Acks of SACKed data during recovery can run past the sends
+        if (m_recordsSends && static_cast<int32_t> (m_ackedSeq - m_sentSeq) > 0)
+          {
+            m_ackedSeq = m_sentSeq;
+          }
+        if (m_recovery && static_cast<int32_t> (m_ackedSeq - m_recover) >= 0)
+          {
+            m_recovery = false;
+            m_episodeDecrease = false;
+          }
+        if (!m_recovery)
+          {
+            m_core.UpdateCapacityEstimate (now, m_ackedSeq);
+          }
+        if (!m_recordsSends)
+          {
+            Send (now, m_ackedSeq + m_cWnd);
+          }
+        if (r.rttUs != 0)
+          {
+            if (m_core.UpdateRound (m_ackedSeq, m_ackedSeq + m_cWnd))
+              {
+                Print (now);
+              }
+            m_core.UpdateRtt (r.rttUs);
+          }
+        break;
+      case TcpLibraTraceRecord::INCREASE_WINDOW:
+        {
+          uint32_t segmentsAcked = r.segmentsAcked;
+          if (m_cWnd < m_ssThresh && segmentsAcked >= 1)
+            {
+              m_cWnd += m_segmentSize;
+              --segmentsAcked;
+            }
+          if (m_cWnd >= m_ssThresh && segmentsAcked > 0)
+            {
+              m_cWnd = m_core.IncreaseWindow (m_cWnd);
+            }
+          m_cWndSum += m_cWnd;
+          ++m_cWndSamples;
+        }
+        break;
+      case TcpLibraTraceRecord::DUPACK:
+        if (!m_episodeDecrease)
+          {
+            m_episodeDecrease = true;
+            m_cWnd = std::max (m_core.DecreaseWindow (m_cWnd), 2 * m_segmentSize);
+            Print (now);
+          }
+        break;
+      case TcpLibraTraceRecord::SSTHRESH:
+        m_ssThresh = m_episodeDecrease ? m_cWnd
+                                       : std::max (m_core.ComputeDecrease (m_cWnd), m_cWnd / 2);
+        m_episodeDecrease = true;
+        m_cWnd = m_ssThresh;
+        m_core.ResetCapacityProbe ();
+        m_recover = m_sentSeq;
+        m_recovery = true;
+        Print (now);
+        break;
+      case TcpLibraTraceRecord::SLOW_START_EXIT:
+        m_ssThresh = m_cWnd;
+        Print (now);
+        break;
+      }
+  }
+
+  uint32_t GetCwnd () const { return m_cWnd; }
+  uint32_t GetSsThresh () const { return m_ssThresh; }
+  double GetMeanCwnd () const { return m_cWndSamples ? m_cWndSum / m_cWndSamples : 0.0; }
+  double GetAlpha () const { return m_core.GetAlpha (); }
+  double GetCapacity () const { return m_core.GetCapacity (); }
+
+private:
+  /// Send new data segment by segment up to highSeq
+  void Send (int64_t now, uint32_t highSeq)
+  {
+    while (static_cast<int32_t> (highSeq - m_sentSeq) > 0)
+      {
+        m_core.OnSend (now, m_sentSeq, m_sentSeq + m_segmentSize);
+        m_sentSeq += m_segmentSize;
+      }
+  }
+
+  void Print (int64_t nowUs)
+  {
+    if (m_out != nullptr)
+      {
+        std::fprintf (m_out, "%.6f %u %u %.6g\n", nowUs * 1e-6, m_cWnd, m_ssThresh,
+                      m_core.GetAlpha ());
+      }
+  }
+
+  TcpLibraCore<int64_t, double> m_core;
+  uint32_t m_segmentSize;
+  uint32_t m_cWnd;
+  uint32_t m_ssThresh;
+  uint32_t m_ackedSeq;
+  uint32_t m_sentSeq;
+  uint32_t m_recover;
+  bool m_recovery;
+  bool m_episodeDecrease;
+  bool m_recordsSends;
+  std::FILE *m_out;
+  double m_cWndSum;
+  uint64_t m_cWndSamples;
+};
+
+/// Path and loss model of TcpLibraGenerateTrace
+struct TcpLibraGeneratorOptions
+{
+  size_t bufferPackets = 100; //!< Drop-tail buffer
+  double lossRate = 0.0;      //!< Random loss probability per ACK
+  uint32_t dupAcks = 0;       //!< DUPACK records before each loss
+  uint32_t seed = 1;          //!< Seed of the random losses
+};
+
+/**
+ * Write a synthetic trace: one window-limited flow over a 12.5MB/s, 20ms
+ * base RTT bottleneck with a drop-tail buffer, driven by the default
+ * control law. A buffer overflow or a random loss gives the configured
+ * DUPACK records, then a GetSsThresh record unless the loss falls in the
+ * recovery of an earlier one; the sender reacts as the replay does, with
+ * one decrease per episode.
+ *
+ * \return 0 on success
+ */
+inline int
+TcpLibraGenerateTrace (const char *path, size_t acks,
+                       const TcpLibraGeneratorOptions &options = TcpLibraGeneratorOptions ())
+{
+  const uint32_t segmentSize = 1000;
+  const double capacity = 12.5e6;
+  const double baseRtt = 0.02;
+  const double buffer = options.bufferPackets * segmentSize;
+  const double bdp = capacity * baseRtt;
+
+  TcpLibraTraceWriter writer;
+  if (!writer.Open (path, segmentSize, 10 * segmentSize, UINT32_MAX))
+    {
+      std::perror (path);
+      return 1;
+    }
+
+  std::mt19937 rng (options.seed);
+  std::bernoulli_distribution randomLoss (options.lossRate);
+  TcpLibraCore<int64_t, double> core;
+  uint32_t cWnd = 10 * segmentSize;
+  uint32_t ssThresh = UINT32_MAX;
+  uint32_t seq = 0;
+  uint32_t sentSeq = 0;
+  uint32_t recover = 0;
+  bool recovery = false;
+  double now = 0.0;
+  for (size_t i = 0; i < acks; ++i)
+    {
+      double queue = std::max (0.0, cWnd - bdp);
+      double rtt = baseRtt + queue / capacity;
+      // Window-limited below the BDP, one segment per serialization time above.
+      now += cWnd < bdp ? rtt * segmentSize / cWnd : segmentSize / capacity;
+      uint32_t timeUs = static_cast<uint32_t> (now * 1e6);
+      uint32_t rttUs = static_cast<uint32_t> (rtt * 1e6);
+
+      if (queue > buffer || (options.lossRate > 0.0 && randomLoss (rng)))
+        {
+          for (uint32_t k = 0; k < options.dupAcks; ++k)
+            {
+              writer.Write (timeUs, 0, 0, TcpLibraTraceRecord::DUPACK);
+              if (k == 0 && !recovery)
+                {
+                  cWnd = std::max (core.DecreaseWindow (cWnd), 2 * segmentSize);
+                }
+            }
+          if (!recovery)
+            {
+              writer.Write (timeUs, 0, 0, TcpLibraTraceRecord::SSTHRESH);
+              ssThresh = options.dupAcks > 0 ? cWnd
+                                             : std::max (core.ComputeDecrease (cWnd), cWnd / 2);
+              cWnd = ssThresh;
+              core.ResetCapacityProbe ();
+              recover = sentSeq;
+              recovery = true;
+            }
+          continue;
+        }
+
+      writer.Write (timeUs, rttUs, 1, TcpLibraTraceRecord::PKTS_ACKED);
+      seq += segmentSize;
+      if (recovery && static_cast<int32_t> (seq - recover) >= 0)
+        {
+          recovery = false;
+        }
+      core.UpdateCapacityEstimate (timeUs, seq);
+      core.UpdateRound (seq, seq + cWnd);
+      core.UpdateRtt (rttUs);
+
+      writer.Write (timeUs, 0, 1, TcpLibraTraceRecord::INCREASE_WINDOW);
+      if (cWnd < ssThresh)
+        {
+          cWnd += segmentSize;
+        }
+      else
+        {
+          cWnd = core.IncreaseWindow (cWnd);
+        }
+
+      // The ACK clock releases the new window, segment by segment
+      while (static_cast<int32_t> (seq + cWnd - sentSeq) >= static_cast<int32_t> (segmentSize))
+        {
+          writer.Write (timeUs, 0, 1, TcpLibraTraceRecord::SEND);
+          core.OnSend (timeUs, sentSeq, sentSeq + segmentSize);
+          sentSeq += segmentSize;
+        }
+    }
+  return 0;
+}
+
+} // namespace ns3
+
+#endif /* LIBRA_REPLAY_H */
@@ -0,0 +1,216 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Per-flow memory and ACK throughput of TcpLibraCore with many flows, to
+ * size large simulations. For 10k and 100k flows and each time type, it
+ * reports:
+ *
+ *   bytes/flow  heap taken by the cores, fresh and after every flow has
+ *               filled its capacity window with packet-pair probes
+ *               (sizeof included)
+ *   Mack/s      congestion avoidance ACKs per second, ACKs spread over the
+ *               flows in a shuffled order as a simulator interleaves them,
+ *               so every ACK touches a cold core
+ *
+ * The ns-3 TcpLibra embeds TcpLibraCore<uint32_t, DataRate>, the "uint32 us"
+ * rows; libra-socket-scale measures whole TcpLibra sockets. Measured on
+ * x86-64 with libstdc++:
+ *
+ *   uint32 us   sizeof 376   376 bytes/flow fresh   640 filled
+ *   int64 us    sizeof 464   464 bytes/flow fresh   728 filled
+ *
+ * of which 58 bytes are the per-flow copy of the configuration (rounds
+ * and samples of the windows, k1, k2, T0, T1, initial capacity and the
+ * arithmetic flags), as ns-3 attributes are per object.
+ *
+ * Standalone, no ns-3 needed:
+ *
+ *   g++ -O2 -std=c++17 -I.. libra-scale-bench.cc -o libra-scale-bench
+ *   ./libra-scale-bench [flows...]
+ */
+
+#include "tcp-libra-core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+// The layout of TcpLibraCore is ordered to keep padding out; a member added
+// in the wrong place, or one too many, shows up here first.
+static_assert (sizeof (void *) != 8
+               || sizeof (TcpLibraCore<uint32_t, double>) <= 376,
+               "TcpLibraCore<uint32_t, double> grew past 376 bytes");
+
+size_t g_allocated = 0;
+
+const uint32_t segmentSize = 1000;
+const double capacity = 12.5e6;  // bytes/s, per flow
+const double baseRtt = 0.02;     // s
+const uint32_t bdp = static_cast<uint32_t> (capacity * baseRtt);
+const size_t acksPerFlow = 64;
+
+template <typename TimeT>
+TimeT
+ToTime (double s)
+{
+  return static_cast<TimeT> (s);
+}
+
+template <>
+int64_t
+ToTime<int64_t> (double s)
+{
+  return static_cast<int64_t> (s * 1e6);
+}
+
+template <>
+uint32_t
+ToTime<uint32_t> (double s)
+{
+  return static_cast<uint32_t> (s * 1e6);
+}
+
+/// What the simulator would keep per flow outside the congestion control
+struct Flow
+{
+  double now;     //!< Arrival time of the last ACK (s)
+  uint32_t seq;    //!< Cumulative ACK sequence
+  uint32_t highTx; //!< Highest sequence sent
+  uint32_t cWnd;   //!< Congestion window (bytes)
+};
+
+template <typename TimeT>
+void
+Run (const char *name, size_t flows)
+{
+  typedef TcpLibraCore<TimeT, double> Core;
+
+  size_t before = g_allocated;
+  std::vector<Core> cores (flows);
+  size_t coreBytes = g_allocated - before;
+  double fresh = static_cast<double> (coreBytes) / flows;
+
+  std::vector<Flow> state (flows);
+  for (size_t i = 0; i < flows; ++i)
+    {
+      state[i].now = 1.0 + i * 1e-6;
+      state[i].seq = 0;
+      state[i].cWnd = bdp;
+      // A probe of two segments a round fills the capacity window
+      Core &core = cores[i];
+      for (uint32_t k = 0; k < core.GetCapacityWindow (); ++k)
+        {
+          core.OnSend (ToTime<TimeT> (state[i].now), state[i].seq, state[i].seq + segmentSize);
+          core.OnSend (ToTime<TimeT> (state[i].now), state[i].seq + segmentSize,
+                       state[i].seq + 2 * segmentSize);
+          state[i].now += baseRtt;
+          state[i].seq += segmentSize;
+          core.UpdateCapacityEstimate (ToTime<TimeT> (state[i].now), state[i].seq);
+          state[i].now += segmentSize / capacity;
+          state[i].seq += segmentSize;
+          core.UpdateCapacityEstimate (ToTime<TimeT> (state[i].now), state[i].seq);
+        }
+      state[i].highTx = state[i].seq + bdp;
+    }
+  double filled = static_cast<double> (g_allocated - before) / flows;
+
+  // Each flow takes acksPerFlow ACKs, in an order that jumps between flows.
+  std::vector<uint32_t> order;
+  order.reserve (flows * acksPerFlow);
+  for (size_t k = 0; k < acksPerFlow; ++k)
+    {
+      for (size_t i = 0; i < flows; ++i)
+        {
+          order.push_back (static_cast<uint32_t> (i));
+        }
+    }
+  std::mt19937 rng (1);
+  std::shuffle (order.begin (), order.end (), rng);
+
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t i : order)
+    {
+      Flow &flow = state[i];
+      Core &core = cores[i];
+      uint32_t queue = (flow.seq / segmentSize) % 100;
+      flow.now += segmentSize / capacity;
+      flow.seq += segmentSize;
+      uint32_t inFlight = bdp + queue * segmentSize;
+      core.UpdateCapacityEstimate (ToTime<TimeT> (flow.now), flow.seq);
+      core.UpdateRound (flow.seq, flow.seq + inFlight);
+      core.UpdateRtt (ToTime<TimeT> (baseRtt + queue * segmentSize / capacity));
+      flow.cWnd = core.IncreaseWindow (flow.cWnd);
+      checksum += flow.cWnd;
+      for (; static_cast<int32_t> (flow.seq + inFlight - flow.highTx) > 0;
+           flow.highTx += segmentSize)
+        {
+          core.OnSend (ToTime<TimeT> (flow.now), flow.highTx, flow.highTx + segmentSize);
+        }
+    }
+  auto stop = std::chrono::steady_clock::now ();
+
+  double seconds = std::chrono::duration<double> (stop - start).count ();
+  std::printf ("%-10s %7zu flows  sizeof %4zu  %7.1f bytes/flow fresh  %7.1f filled  "
+               "%6.2f Mack/s  (checksum %llu)\n",
+               name, flows, sizeof (Core), fresh, filled, order.size () / seconds / 1e6,
+               static_cast<unsigned long long> (checksum));
+}
+
+} // namespace
+
+// Count heap bytes, so the per-flow figure includes what the cores
+// allocate. Containers free through the sized delete.
+void *
+operator new (size_t size)
+{
+  void *p = std::malloc (size);
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  g_allocated += size;
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, size_t size) noexcept
+{
+  g_allocated -= size;
+  std::free (p);
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::vector<size_t> counts;
+  for (int i = 1; i < argc; ++i)
+    {
+      counts.push_back (std::strtoul (argv[i], nullptr, 10));
+    }
+  if (counts.empty ())
+    {
+      counts = {10000, 100000};
+    }
+
+  for (size_t flows : counts)
+    {
+      Run<double> ("double s", flows);
+      Run<int64_t> ("int64 us", flows);
+      Run<uint32_t> ("uint32 us", flows);
+    }
+  return 0;
+}
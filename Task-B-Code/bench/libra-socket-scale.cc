@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Per-socket memory of the ns-3 TcpLibra, to size simulations with many
+ * flows. libra-scale-bench measures TcpLibraCore alone; this creates real
+ * TcpLibra objects and counts every heap byte they hold, the TcpNewReno
+ * and Object bases and the optional blocks included:
+ *
+ *   created    CreateObject<TcpLibra>, as the socket factory does
+ *   forked     Fork of one created TcpLibra, as accepted connections get
+ *   init       forked, then Init on a TcpSocketState of its own, as at the
+ *              end of the handshake (the state itself is not counted)
+ *   traced     init, then the Alpha trace source connected
+ *
+ * Needs ns-3.35 with TcpLibra in src/internet/model; libra-bench.sh copies
+ * it to scratch:
+ *
+ *   ./waf --run "scratch/libra-socket-scale --flows=100000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/tcp-libra.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+size_t g_allocated = 0;
+
+// ns-3 frees through both the sized and the unsized delete, so each block
+// carries its size in front of it.
+const size_t headerSize = alignof (std::max_align_t);
+
+void
+NoopAlpha (double oldValue, double newValue)
+{
+}
+
+void
+Report (const char *name, size_t flows, size_t before)
+{
+  std::printf ("%-8s %7zu sockets  %7.1f bytes/socket\n", name, flows,
+               static_cast<double> (g_allocated - before) / flows);
+}
+
+} // namespace
+
+void *
+operator new (size_t size)
+{
+  char *p = static_cast<char *> (std::malloc (size + headerSize));
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  *reinterpret_cast<size_t *> (p) = size;
+  g_allocated += size;
+  return p + headerSize;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  if (p == nullptr)
+    {
+      return;
+    }
+  char *block = static_cast<char *> (p) - headerSize;
+  g_allocated -= *reinterpret_cast<size_t *> (block);
+  std::free (block);
+}
+
+void
+operator delete (void *p, size_t size) noexcept
+{
+  operator delete (p);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t flows = 100000;
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("flows", "Number of TcpLibra objects", flows);
+  cmd.Parse (argc, argv);
+
+  std::printf ("sizeof TcpLibra %zu, TcpNewReno %zu, TcpLibraCore %zu\n", sizeof (TcpLibra),
+               sizeof (TcpNewReno), sizeof (TcpLibraCore<uint32_t, DataRate>));
+
+  std::vector<Ptr<TcpCongestionOps> > sockets;
+  sockets.reserve (flows);
+  std::vector<Ptr<TcpSocketState> > tcbs;
+  tcbs.reserve (flows);
+  for (uint32_t i = 0; i < flows; ++i)
+    {
+      tcbs.push_back (CreateObject<TcpSocketState> ());
+      tcbs.back ()->m_segmentSize = 1000;
+    }
+
+  size_t before = g_allocated;
+  for (uint32_t i = 0; i < flows; ++i)
+    {
+      sockets.push_back (CreateObject<TcpLibra> ());
+    }
+  Report ("created", flows, before);
+  sockets.clear ();
+
+  Ptr<TcpLibra> listener = CreateObject<TcpLibra> ();
+  before = g_allocated;
+  for (uint32_t i = 0; i < flows; ++i)
+    {
+      sockets.push_back (listener->Fork ());
+    }
+  Report ("forked", flows, before);
+
+  for (uint32_t i = 0; i < flows; ++i)
+    {
+      sockets[i]->Init (tcbs[i]);
+    }
+  Report ("init", flows, before);
+
+  for (uint32_t i = 0; i < flows; ++i)
+    {
+      sockets[i]->TraceConnectWithoutContext ("Alpha", MakeCallback (&NoopAlpha));
+    }
+  Report ("traced", flows, before);
+
+  sockets.clear ();
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Overhead of the TcpLibra internals tracing on the congestion avoidance
+ * path, outside ns-3:
+ *
+ *   core      TcpLibraCore alone
+ *   disabled  plus what TcpLibra adds per ACK with no sink connected: the
+ *             law update check, the BaseRtt compare and a call into an
+ *             empty callback list, like TracedValue and TracedCallback
+ *   enabled   plus a TcpLibraTraceRing push for the adder of every ACK
+ *             and for each terms update, drained to a file by its thread
+ *
+ * Standalone, no ns-3 needed:
+ *
+ *   g++ -O2 -std=c++17 -pthread -I.. libra-trace-bench.cc -o libra-trace-bench
+ *   ./libra-trace-bench [acks]
+ */
+
+#include "tcp-libra-core.h"
+#include "tcp-libra-trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+const uint32_t segmentSize = 1000;
+const double capacity = 12.5e6;  // bytes/s
+const int64_t baseRttUs = 20000;
+const uint32_t bdp = static_cast<uint32_t> (capacity * baseRttUs * 1e-6);
+
+enum Mode
+{
+  CORE,
+  DISABLED,
+  ENABLED,
+};
+
+/// Stand-in for TracedValue: compare, then run the callbacks on a change
+template <typename T>
+struct Traced
+{
+  T value {};
+  std::list<std::function<void (T, T)>> callbacks;
+
+  void Set (T v)
+  {
+    if (v == value)
+      {
+        return;
+      }
+    T old = value;
+    value = v;
+    for (auto &cb : callbacks)
+      {
+        cb (old, v);
+      }
+  }
+};
+
+double
+Run (Mode mode, size_t acks, TcpLibraTraceRing *sink)
+{
+  TcpLibraCore<int64_t, double> core;
+  Traced<double> alpha;
+  Traced<double> penalty;
+  Traced<int64_t> baseRtt;
+  std::list<std::function<void (uint32_t, double)>> adder;
+  uint32_t lawUpdates = 0;
+  uint32_t timeUs = 0;
+  if (mode == ENABLED)
+    {
+      alpha.callbacks.push_back ([&] (double, double v)
+        { sink->Push (timeUs, 0, TcpLibraTraceRing::ALPHA, v); });
+      penalty.callbacks.push_back ([&] (double, double v)
+        { sink->Push (timeUs, 0, TcpLibraTraceRing::PENALTY, v); });
+      baseRtt.callbacks.push_back ([&] (int64_t, int64_t v)
+        { sink->Push (timeUs, 0, TcpLibraTraceRing::BASE_RTT, v * 1e-6); });
+      adder.push_back ([&] (uint32_t, double v)
+        { sink->Push (timeUs, 0, TcpLibraTraceRing::ADDER, v); });
+    }
+
+  uint32_t cWnd = bdp;
+  uint32_t seq = 0;
+  uint32_t sent = bdp;
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now ();
+  for (size_t i = 0; i < acks; ++i)
+    {
+      uint32_t queue = static_cast<uint32_t> (i % 800 < 400 ? i % 400 : 400 - i % 400) / 4;
+      timeUs += 80;
+      seq += segmentSize;
+      core.UpdateCapacityEstimate (timeUs, seq);
+      core.UpdateRound (seq, seq + bdp + queue * segmentSize);
+      core.UpdateRtt (baseRttUs + queue * 80);
+      cWnd = core.IncreaseWindow (cWnd);
+      for (; static_cast<int32_t> (seq + bdp + queue * segmentSize - sent) > 0; sent += segmentSize)
+        {
+          core.OnSend (timeUs, sent, sent + segmentSize);
+        }
+      if (mode != CORE)
+        {
+          baseRtt.Set (core.GetBaseRtt ());
+          if (core.GetLawUpdates () != lawUpdates)
+            {
+              lawUpdates = core.GetLawUpdates ();
+              alpha.Set (core.GetAlpha ());
+              penalty.Set (core.GetPenalty ());
+            }
+          double a = core.GetAdder (cWnd);
+          for (auto &cb : adder)
+            {
+              cb (cWnd, a);
+            }
+        }
+      checksum += cWnd;
+    }
+  auto stop = std::chrono::steady_clock::now ();
+  if (checksum == 0)
+    {
+      std::printf ("(checksum 0)\n");
+    }
+  return std::chrono::duration<double, std::nano> (stop - start).count () / acks;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  size_t acks = argc > 1 ? std::strtoul (argv[1], nullptr, 10) : 10000000;
+  const char *path = "/tmp/libra-internals.bin";
+
+  double core = Run (CORE, acks, nullptr);
+  double disabled = Run (DISABLED, acks, nullptr);
+  TcpLibraTraceRing sink;
+  if (!sink.Open (path))
+    {
+      std::perror (path);
+      return 1;
+    }
+  double enabled = Run (ENABLED, acks, &sink);
+  sink.Close ();
+
+  std::printf ("core      %6.2f ns/ACK\n", core);
+  std::printf ("disabled  %6.2f ns/ACK  (+%.2f)\n", disabled, disabled - core);
+  std::printf ("enabled   %6.2f ns/ACK  (+%.2f), %llu samples dropped\n", enabled,
+               enabled - core, static_cast<unsigned long long> (sink.GetDropped ()));
+  return 0;
+}
@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Cost of logging queue lengths, outside ns-3: a 100s run sampled every
+ * 10ms, for 1 and 16 queues.
+ *
+ *   reopen   the old CheckQueueSize: both .plotme files opened, appended
+ *            to and closed for every sample
+ *   text     QueueMonitorBuffer writing the same text in blocks
+ *   binary   QueueMonitorBuffer writing .bin blocks
+ *
+ * Standalone, no ns-3 needed:
+ *
+ *   g++ -O2 -std=c++17 -I.. queue-monitor-bench.cc -o queue-monitor-bench
+ *   ./queue-monitor-bench [samples]
+ */
+
+#include "queue-monitor-buffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+enum Mode
+{
+  REOPEN,
+  TEXT,
+  BINARY,
+};
+
+const char *names[] = {"reopen", "text", "binary"};
+
+/// Queue length of a sawtooth between 0 and 100 packets
+uint32_t
+Length (size_t sample, size_t queue)
+{
+  size_t phase = (sample + queue * 7) % 200;
+  return static_cast<uint32_t> (phase < 100 ? phase : 200 - phase);
+}
+
+/// \return microseconds per sample, over all queues
+double
+Run (Mode mode, size_t samples, size_t queues)
+{
+  std::vector<std::string> prefixes;
+  for (size_t q = 0; q < queues; ++q)
+    {
+      std::stringstream prefix;
+      prefix << "/tmp/queue-monitor-bench-" << q;
+      prefixes.push_back (prefix.str ());
+      std::remove ((prefixes[q] + ".plotme").c_str ());
+      std::remove ((prefixes[q] + "_avg.plotme").c_str ());
+    }
+  std::vector<std::unique_ptr<QueueMonitorBuffer> > buffers;
+  std::vector<double> sums (queues, 0);
+
+  auto start = std::chrono::steady_clock::now ();
+  if (mode != REOPEN)
+    {
+      for (size_t q = 0; q < queues; ++q)
+        {
+          buffers.emplace_back (new QueueMonitorBuffer);
+          buffers[q]->Open (prefixes[q], mode == BINARY ? QueueMonitorBuffer::BINARY
+                                                        : QueueMonitorBuffer::TEXT);
+        }
+    }
+  for (size_t i = 0; i < samples; ++i)
+    {
+      double now = i * 0.01;
+      for (size_t q = 0; q < queues; ++q)
+        {
+          uint32_t qSize = Length (i, q);
+          sums[q] += qSize;
+          if (mode != REOPEN)
+            {
+              buffers[q]->Append (now, qSize, sums[q] / (i + 1));
+              continue;
+            }
+          std::ofstream fPlotQueue ((prefixes[q] + ".plotme").c_str (),
+                                    std::ios::out | std::ios::app);
+          fPlotQueue << now << " " << qSize << std::endl;
+          fPlotQueue.close ();
+
+          std::ofstream fPlotQueueAvg ((prefixes[q] + "_avg.plotme").c_str (),
+                                       std::ios::out | std::ios::app);
+          fPlotQueueAvg << now << " " << sums[q] / (i + 1) << std::endl;
+          fPlotQueueAvg.close ();
+        }
+    }
+  for (size_t q = 0; q < buffers.size (); ++q)
+    {
+      buffers[q]->Close ();
+    }
+  auto stop = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::micro> (stop - start).count () / samples;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  size_t samples = argc > 1 ? std::strtoul (argv[1], nullptr, 10) : 10000;
+  const size_t queues[] = {1, 16};
+
+  for (size_t queueCount : queues)
+    {
+      double reopen = Run (REOPEN, samples, queueCount);
+      for (int mode = REOPEN; mode <= BINARY; ++mode)
+        {
+          double us = mode == REOPEN ? reopen : Run (static_cast<Mode> (mode), samples, queueCount);
+          std::printf ("%2zu queues  %-6s  %8.2f us/sample  %7.1f ms per %zu samples  x%.0f\n",
+                       queueCount, names[mode], us, us * samples * 1e-3, samples, reopen / us);
+        }
+    }
+  return 0;
+}
@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "flow-stats-collector.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FlowStatsCollector");
+
+FlowStatsCollector::FlowStatsCollector (Ptr<FlowMonitor> monitor, uint32_t fairnessFlows)
+  : m_monitor (monitor),
+    m_fairnessFlows (fairnessFlows)
+{
+  NS_LOG_FUNCTION (this << monitor << fairnessFlows);
+}
+
+FlowStatsCollector::~FlowStatsCollector ()
+{
+  NS_LOG_FUNCTION (this);
+  m_event.Cancel ();
+}
+
+FlowStatsSummary
+FlowStatsCollector::Collect () const
+{
+  NS_LOG_FUNCTION (this);
+  // SerializeToXmlStream runs the same check before writing the flows
+  m_monitor->CheckForLostPackets ();
+  FlowStatsSummary summary (m_fairnessFlows);
+  const FlowMonitor::FlowStatsContainer &stats = m_monitor->GetFlowStats ();
+  for (FlowMonitor::FlowStatsContainerCI it = stats.begin (); it != stats.end (); ++it)
+    {
+      FlowStatsRecord flow;
+      flow.flowId = it->first;
+      flow.txPackets = it->second.txPackets;
+      flow.rxPackets = it->second.rxPackets;
+      flow.rxBytes = it->second.rxBytes;
+      flow.lostPackets = it->second.lostPackets;
+      flow.delaySum = it->second.delaySum.ToDouble (Time::NS);
+      flow.timeFirstRxPacket = it->second.timeFirstRxPacket.ToDouble (Time::NS);
+      flow.timeLastRxPacket = it->second.timeLastRxPacket.ToDouble (Time::NS);
+      summary.Add (flow);
+    }
+  return summary;
+}
+
+void
+FlowStatsCollector::StartSnapshots (Time interval, const std::string &path)
+{
+  NS_LOG_FUNCTION (this << interval << path);
+  NS_ABORT_MSG_UNLESS (interval.IsStrictlyPositive (), "FlowStatsCollector: bad interval");
+  m_csv.open (path.c_str ());
+  NS_ABORT_MSG_UNLESS (m_csv, "FlowStatsCollector: cannot create " << path);
+  m_csv << FlowStatsSummary::CsvHeader () << "\n";
+  m_interval = interval;
+  m_event.Cancel ();
+  m_event = Simulator::Schedule (m_interval, &FlowStatsCollector::Snapshot, this);
+}
+
+void
+FlowStatsCollector::Snapshot ()
+{
+  m_csv << Collect ().CsvRow (Simulator::Now ().GetSeconds ()) << "\n";
+  m_event = Simulator::Schedule (m_interval, &FlowStatsCollector::Snapshot, this);
+}
+
+FlowStatsSummary
+FlowStatsCollector::Finish (const std::string &jsonPath)
+{
+  NS_LOG_FUNCTION (this << jsonPath);
+  m_event.Cancel ();
+  FlowStatsSummary summary = Collect ();
+  if (m_csv.is_open ())
+    {
+      m_csv << summary.CsvRow (Simulator::Now ().GetSeconds ()) << "\n";
+      m_csv.close ();
+    }
+  if (!jsonPath.empty ())
+    {
+      std::ofstream json (jsonPath.c_str ());
+      NS_ABORT_MSG_UNLESS (json, "FlowStatsCollector: cannot create " << jsonPath);
+      json << summary.Json () << "\n";
+    }
+  return summary;
+}
+
+} // namespace ns3
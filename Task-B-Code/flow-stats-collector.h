@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef FLOW_STATS_COLLECTOR_H
+#define FLOW_STATS_COLLECTOR_H
+
+#include "flow-stats-summary.h"
+#include "flow-monitor.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+
+#include <fstream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup flow-monitor
+ *
+ * \brief flowmon.py and Fairness.py metrics straight from a FlowMonitor
+ *
+ * Reads FlowMonitor::GetFlowStats instead of the XML dump, so a run can
+ * skip SerializeToXmlFile. Optionally appends a CSV row of the metrics
+ * every interval during the run; Finish writes the last row and a JSON
+ * object with the final metrics.
+ *
+ * \code
+ *   FlowStatsCollector flowStats (flowMonitor);
+ *   flowStats.StartSnapshots (Seconds (1), "Task_B/flowstats.csv");
+ *   Simulator::Run ();
+ *   FlowStatsSummary summary = flowStats.Finish ("Task_B/flowstats.json");
+ *   summary.PrintThroughput (std::cout);
+ * \endcode
+ */
+class FlowStatsCollector
+{
+public:
+  /**
+   * \param monitor the installed flow monitor
+   * \param fairnessFlows highest flow id counted in the Jain's indexes
+   */
+  explicit FlowStatsCollector (Ptr<FlowMonitor> monitor, uint32_t fairnessFlows = 50);
+  ~FlowStatsCollector ();
+
+  FlowStatsCollector (const FlowStatsCollector&) = delete;
+  FlowStatsCollector& operator= (const FlowStatsCollector&) = delete;
+
+  /**
+   * \brief The metrics now, after the lost packet check that the XML dump does
+   * \return the summary of every flow
+   */
+  FlowStatsSummary Collect () const;
+
+  /**
+   * \brief Append the metrics to a CSV file every interval
+   * \param interval time between rows
+   * \param path the CSV file
+   */
+  void StartSnapshots (Time interval, const std::string &path);
+
+  /**
+   * \brief Stop the snapshots and write the final metrics
+   * \param jsonPath JSON output, none if empty
+   * \return the final summary
+   */
+  FlowStatsSummary Finish (const std::string &jsonPath);
+
+private:
+  /// Append a CSV row and schedule the next one
+  void Snapshot ();
+
+  Ptr<FlowMonitor> m_monitor; //!< Source of the statistics
+  uint32_t m_fairnessFlows;   //!< Highest flow id in the Jain's indexes
+  Time m_interval;            //!< Snapshot interval
+  EventId m_event;            //!< Next snapshot
+  std::ofstream m_csv;        //!< Snapshot rows
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_COLLECTOR_H */
@@ -0,0 +1,343 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef FLOW_STATS_SUMMARY_H
+#define FLOW_STATS_SUMMARY_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup flow-monitor
+ *
+ * \brief The FlowMonitor statistics of one flow that the summary reads
+ *
+ * Times are in nanoseconds, as in the flow monitor XML.
+ */
+struct FlowStatsRecord
+{
+  uint32_t flowId;          //!< Flow id
+  uint64_t txPackets;       //!< Packets sent
+  uint64_t rxPackets;       //!< Packets received
+  uint64_t rxBytes;         //!< Bytes received
+  uint64_t lostPackets;     //!< Packets declared lost
+  double delaySum;          //!< Sum of the delays of the received packets (ns)
+  double timeFirstRxPacket; //!< First reception (ns)
+  double timeLastRxPacket;  //!< Last reception (ns)
+};
+
+/**
+ * \ingroup flow-monitor
+ *
+ * \brief Network metrics of flowmon.py and Fairness.py, computed in one pass
+ *
+ * Flows are added one at a time, in flow id order like the XML, and only
+ * the sums are kept. The arithmetic is the scripts', quirks included, so
+ * PrintThroughput and PrintFairness print the same text they do:
+ *
+ *  - the receive window starts at the first flow's first reception and is
+ *    replaced by any earlier one, but a flow that received nothing (time 0)
+ *    also resets it, as in flowmon.py;
+ *  - the fairness split is by flow id parity among ids up to
+ *    fairnessFlows, even ids "Libra" and odd ids "BIC", with each flow's
+ *    throughput taken over the window seen so far, as in Fairness.py.
+ */
+class FlowStatsSummary
+{
+public:
+  /**
+   * \param fairnessFlows highest flow id counted in the Jain's indexes
+   */
+  explicit FlowStatsSummary (uint32_t fairnessFlows = 50)
+    : m_fairnessFlows (fairnessFlows),
+      m_flows (0),
+      m_rxBytes (0),
+      m_rxPackets (0),
+      m_txPackets (0),
+      m_lostPackets (0),
+      m_delaySum (0),
+      m_start (0),
+      m_stop (0),
+      m_sumBic (0),
+      m_sumSquaresBic (0),
+      m_countBic (0),
+      m_sumLibra (0),
+      m_sumSquaresLibra (0),
+      m_countLibra (0)
+  {
+  }
+
+  /// \param flow the statistics of the next flow, in flow id order
+  void Add (const FlowStatsRecord &flow)
+  {
+    m_flows++;
+    m_rxBytes += flow.rxBytes;
+    m_rxPackets += flow.rxPackets;
+    m_txPackets += flow.txPackets;
+    m_delaySum += flow.delaySum;
+    m_lostPackets += flow.lostPackets;
+    if (m_start == 0 || flow.timeFirstRxPacket < m_start)
+      {
+        m_start = flow.timeFirstRxPacket;
+      }
+    if (flow.timeLastRxPacket > m_stop)
+      {
+        m_stop = flow.timeLastRxPacket;
+      }
+
+    double throughput = flow.rxBytes * 8.0 / (m_stop - m_start) / 1024;
+    if (flow.flowId <= m_fairnessFlows)
+      {
+        if (flow.flowId % 2 == 0)
+          {
+            m_countLibra++;
+            m_sumLibra += throughput;
+            m_sumSquaresLibra += throughput * throughput;
+          }
+        else
+          {
+            m_countBic++;
+            m_sumBic += throughput;
+            m_sumSquaresBic += throughput * throughput;
+          }
+      }
+  }
+
+  /// \return flows added
+  uint64_t GetFlows () const { return m_flows; }
+  /// \return bits received by all flows
+  uint64_t GetReceivedBits () const { return m_rxBytes * 8; }
+  /// \return packets received by all flows
+  uint64_t GetReceivedPackets () const { return m_rxPackets; }
+  /// \return packets sent by all flows
+  uint64_t GetTransmittedPackets () const { return m_txPackets; }
+  /// \return packets lost by all flows
+  uint64_t GetLostPackets () const { return m_lostPackets; }
+  /// \return start of the receive window (s)
+  double GetStart () const { return m_start * 1e-9; }
+  /// \return end of the receive window (s)
+  double GetStop () const { return m_stop * 1e-9; }
+  /// \return length of the receive window (s)
+  double GetDuration () const { return (m_stop - m_start) * 1e-9; }
+
+  /// \return bits received over the receive window (kbit/s)
+  double GetThroughput () const
+  {
+    return m_rxBytes * 8 / (GetDuration () * 1e3);
+  }
+
+  /// \return packets received over packets sent
+  double GetDeliveryRatio () const
+  {
+    return m_rxPackets * 1.0 / m_txPackets;
+  }
+
+  /// \return packets lost over packets sent
+  double GetDropRatio () const
+  {
+    return m_lostPackets * 1.0 / m_txPackets;
+  }
+
+  /// \return mean delay of the received packets (ms)
+  double GetMeanDelay () const
+  {
+    return m_delaySum * 1e-6 / m_rxPackets;
+  }
+
+  /// \return Jain's index of the odd flow ids
+  double GetJainBic () const
+  {
+    return (m_sumBic * m_sumBic) / (m_countBic * m_sumSquaresBic);
+  }
+
+  /// \return Jain's index of the even flow ids
+  double GetJainLibra () const
+  {
+    return (m_sumLibra * m_sumLibra) / (m_countLibra * m_sumSquaresLibra);
+  }
+
+  /// \param os where to print what flowmon.py prints
+  void PrintThroughput (std::ostream &os) const
+  {
+    os << "\nThrougput Calculation : \n"
+       << "Total Received bits = " << GetReceivedBits () << "\n"
+       << Format ("Receiving Packet Start time = %.3f sec\n", GetStart ())
+       << Format ("Receiving Packet Stop time = %.3f sec\n", GetStop ())
+       << Format ("Receiving Packet Duration time = %.3f sec\n", GetDuration ())
+       << Format ("Network Throughput = %.7f Kbps\n", GetThroughput ())
+       << "\nRatio Calculation : \n"
+       << "Total Transmitted Packets = " << m_txPackets << "\n"
+       << "Total Received Packets = " << m_rxPackets << "\n"
+       << Format ("Packet Delivery Ratio = %.7f \n", GetDeliveryRatio ())
+       << Format ("Packet Drop Ratio = %.7f \n", GetDropRatio ())
+       << Format ("Network Mean Delay = %.7f ms\n", GetMeanDelay ());
+  }
+
+  /// \param os where to print what Fairness.py prints
+  void PrintFairness (std::ostream &os) const
+  {
+    os << "Fairness Calculation : \n"
+       << "Jain's Index for BIC: " << FormatRepr (GetJainBic ()) << "\n"
+       << "Jain's Index for Libra: " << FormatRepr (GetJainLibra ()) << "\n";
+  }
+
+  /// \return the column names of CsvRow
+  static std::string CsvHeader ()
+  {
+    return "time,flows,rxBits,txPackets,rxPackets,lostPackets,throughputKbps,deliveryRatio,"
+           "dropRatio,meanDelayMs,jainBic,jainLibra";
+  }
+
+  /**
+   * \param time snapshot time (s)
+   * \return the metrics as one CSV line, without the newline
+   */
+  std::string CsvRow (double time) const
+  {
+    char line[512];
+    std::snprintf (line, sizeof (line), "%g,%llu,%llu,%llu,%llu,%llu,%.7f,%.7f,%.7f,%.7f,%s,%s",
+                   time, static_cast<unsigned long long> (m_flows),
+                   static_cast<unsigned long long> (GetReceivedBits ()),
+                   static_cast<unsigned long long> (m_txPackets),
+                   static_cast<unsigned long long> (m_rxPackets),
+                   static_cast<unsigned long long> (m_lostPackets), GetThroughput (),
+                   GetDeliveryRatio (), GetDropRatio (), GetMeanDelay (),
+                   FormatRepr (GetJainBic ()).c_str (), FormatRepr (GetJainLibra ()).c_str ());
+    return line;
+  }
+
+  /// \return the metrics as one JSON object, without the newline
+  std::string Json () const
+  {
+    char line[1024];
+    std::snprintf (line, sizeof (line),
+                   "{\"flows\": %llu, \"rxBits\": %llu, \"txPackets\": %llu, \"rxPackets\": %llu, "
+                   "\"lostPackets\": %llu, \"start\": %s, \"stop\": %s, \"throughputKbps\": %s, "
+                   "\"deliveryRatio\": %s, \"dropRatio\": %s, \"meanDelayMs\": %s, "
+                   "\"jainBic\": %s, \"jainLibra\": %s}",
+                   static_cast<unsigned long long> (m_flows),
+                   static_cast<unsigned long long> (GetReceivedBits ()),
+                   static_cast<unsigned long long> (m_txPackets),
+                   static_cast<unsigned long long> (m_rxPackets),
+                   static_cast<unsigned long long> (m_lostPackets),
+                   JsonNumber (GetStart ()).c_str (), JsonNumber (GetStop ()).c_str (),
+                   JsonNumber (GetThroughput ()).c_str (),
+                   JsonNumber (GetDeliveryRatio ()).c_str (),
+                   JsonNumber (GetDropRatio ()).c_str (), JsonNumber (GetMeanDelay ()).c_str (),
+                   JsonNumber (GetJainBic ()).c_str (), JsonNumber (GetJainLibra ()).c_str ());
+    return line;
+  }
+
+  /**
+   * \param value a number
+   * \return value as Python's str () writes a float
+   */
+  static std::string FormatRepr (double value)
+  {
+    if (std::isnan (value))
+      {
+        return "nan";
+      }
+    if (std::isinf (value))
+      {
+        return value < 0 ? "-inf" : "inf";
+      }
+    // Shortest scientific form that reads back as the same double
+    char sci[32];
+    for (int precision = 0; precision < 17; ++precision)
+      {
+        std::snprintf (sci, sizeof (sci), "%.*e", precision, value);
+        if (std::strtod (sci, nullptr) == value)
+          {
+            break;
+          }
+      }
+    std::string text (sci);
+    std::string sign = text[0] == '-' ? "-" : "";
+    size_t e = text.find ('e');
+    int exponent = std::atoi (text.c_str () + e + 1);
+    std::string digits;
+    for (size_t i = sign.size (); i < e; ++i)
+      {
+        if (text[i] != '.')
+          {
+            digits += text[i];
+          }
+      }
+    if (exponent < -4 || exponent >= 16)
+      {
+        std::string mantissa = digits.substr (0, 1);
+        if (digits.size () > 1)
+          {
+            mantissa += "." + digits.substr (1);
+          }
+        char tail[16];
+        std::snprintf (tail, sizeof (tail), "e%c%02d", exponent < 0 ? '-' : '+',
+                       std::abs (exponent));
+        return sign + mantissa + tail;
+      }
+    if (exponent < 0)
+      {
+        return sign + "0." + std::string (-exponent - 1, '0') + digits;
+      }
+    if (digits.size () <= static_cast<size_t> (exponent) + 1)
+      {
+        return sign + digits + std::string (exponent + 1 - digits.size (), '0') + ".0";
+      }
+    return sign + digits.substr (0, exponent + 1) + "." + digits.substr (exponent + 1);
+  }
+
+private:
+  /// \return value formatted by a printf format with one double
+  static std::string Format (const char *format, double value)
+  {
+    char text[128];
+    std::snprintf (text, sizeof (text), format, value);
+    return text;
+  }
+
+  /// \return value as a JSON number, null if it is not finite
+  static std::string JsonNumber (double value)
+  {
+    return std::isfinite (value) ? FormatRepr (value) : "null";
+  }
+
+  uint32_t m_fairnessFlows;   //!< Highest flow id in the Jain's indexes
+  uint64_t m_flows;           //!< Flows added
+  uint64_t m_rxBytes;         //!< Bytes received
+  uint64_t m_rxPackets;       //!< Packets received
+  uint64_t m_txPackets;       //!< Packets sent
+  uint64_t m_lostPackets;     //!< Packets lost
+  double m_delaySum;          //!< Sum of the delays (ns)
+  double m_start;             //!< Start of the receive window (ns)
+  double m_stop;              //!< End of the receive window (ns)
+  double m_sumBic;            //!< Sum of the odd flow throughputs
+  double m_sumSquaresBic;     //!< Sum of their squares
+  uint64_t m_countBic;        //!< Odd flows
+  double m_sumLibra;          //!< Sum of the even flow throughputs
+  double m_sumSquaresLibra;   //!< Sum of their squares
+  uint64_t m_countLibra;      //!< Even flows
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_SUMMARY_H */
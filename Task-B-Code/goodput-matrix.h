@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef GOODPUT_MATRIX_H
+#define GOODPUT_MATRIX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Goodput of a set of flows, min, median and max per flow
+ */
+struct GoodputStats
+{
+  uint32_t flows;    //!< Flows counted
+  double aggregate;  //!< Sum over the flows (bit/s)
+  double min;        //!< Lowest flow (bit/s)
+  double median;     //!< Median flow (bit/s)
+  double max;        //!< Highest flow (bit/s)
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Bytes received by every flow in every sampling interval
+ *
+ * Receive only adds to the byte counter of the flow; Sample closes the
+ * interval by appending the counters as one row of a time x flow matrix
+ * (row-major, next to a column of sample times) and clearing them. The
+ * matrix is written as one text file: a "# time <variant>..." header, then
+ * a row per interval with the sample time and the goodput of each flow in
+ * Mbit/s over that interval.
+ */
+class GoodputMatrix
+{
+public:
+  GoodputMatrix ()
+    : m_start (0)
+  {
+  }
+
+  /**
+   * \param variant label of the flow, e.g. its congestion control
+   * \return the index of the flow
+   */
+  uint32_t AddFlow (const std::string &variant)
+  {
+    m_variants.push_back (variant);
+    m_current.push_back (0);
+    m_total.push_back (0);
+    return static_cast<uint32_t> (m_variants.size () - 1);
+  }
+
+  /// \return the number of flows
+  uint32_t GetFlows () const
+  {
+    return static_cast<uint32_t> (m_variants.size ());
+  }
+
+  /**
+   * \param flow index returned by AddFlow
+   * \return the label of the flow
+   */
+  const std::string &GetVariant (uint32_t flow) const
+  {
+    return m_variants[flow];
+  }
+
+  /**
+   * \brief Start the first interval, forgetting what was received so far
+   * \param time start time (s)
+   * \param intervals expected number of samples, to size the matrix once
+   */
+  void Start (double time, size_t intervals)
+  {
+    m_start = time;
+    std::fill (m_current.begin (), m_current.end (), 0);
+    std::fill (m_total.begin (), m_total.end (), 0);
+    m_times.clear ();
+    m_bytes.clear ();
+    m_times.reserve (intervals);
+    m_bytes.reserve (intervals * m_variants.size ());
+  }
+
+  /**
+   * \param flow index returned by AddFlow
+   * \param bytes bytes received
+   */
+  void Receive (uint32_t flow, uint32_t bytes)
+  {
+    m_current[flow] += bytes;
+  }
+
+  /**
+   * \brief Close the current interval
+   * \param time end of the interval (s)
+   */
+  void Sample (double time)
+  {
+    m_times.push_back (time);
+    m_bytes.insert (m_bytes.end (), m_current.begin (), m_current.end ());
+    for (size_t i = 0; i < m_current.size (); ++i)
+      {
+        m_total[i] += m_current[i];
+        m_current[i] = 0;
+      }
+  }
+
+  /// \return the number of samples
+  size_t GetSamples () const
+  {
+    return m_times.size ();
+  }
+
+  /**
+   * \param flow index returned by AddFlow
+   * \return bytes of the flow in the closed intervals
+   */
+  uint64_t GetTotal (uint32_t flow) const
+  {
+    return m_total[flow];
+  }
+
+  /**
+   * \brief Goodput over the closed intervals, from Start to the last Sample
+   * \param variant flows with this label, all if empty
+   * \return the statistics, zero if no flow matches
+   */
+  GoodputStats GetStats (const std::string &variant) const
+  {
+    GoodputStats stats = {0, 0, 0, 0, 0};
+    double duration = m_times.empty () ? 0 : m_times.back () - m_start;
+    std::vector<double> rates;
+    for (size_t i = 0; i < m_variants.size (); ++i)
+      {
+        if (variant.empty () || m_variants[i] == variant)
+          {
+            rates.push_back (duration > 0 ? m_total[i] * 8 / duration : 0);
+          }
+      }
+    if (rates.empty ())
+      {
+        return stats;
+      }
+    std::sort (rates.begin (), rates.end ());
+    stats.flows = static_cast<uint32_t> (rates.size ());
+    for (double rate : rates)
+      {
+        stats.aggregate += rate;
+      }
+    size_t mid = rates.size () / 2;
+    stats.min = rates.front ();
+    stats.median = rates.size () % 2 ? rates[mid] : (rates[mid - 1] + rates[mid]) / 2;
+    stats.max = rates.back ();
+    return stats;
+  }
+
+  /**
+   * \brief Write the matrix in Mbit/s
+   * \param path output file
+   * \return true on success
+   */
+  bool Write (const std::string &path) const
+  {
+    std::FILE *file = std::fopen (path.c_str (), "w");
+    if (file == nullptr)
+      {
+        return false;
+      }
+    std::fprintf (file, "# time");
+    for (const std::string &variant : m_variants)
+      {
+        std::fprintf (file, " %s", variant.c_str ());
+      }
+    std::fprintf (file, "\n");
+    size_t flows = m_variants.size ();
+    double last = m_start;
+    for (size_t row = 0; row < m_times.size (); ++row)
+      {
+        double interval = m_times[row] - last;
+        last = m_times[row];
+        std::fprintf (file, "%g", m_times[row]);
+        for (size_t i = 0; i < flows; ++i)
+          {
+            double bytes = static_cast<double> (m_bytes[row * flows + i]);
+            std::fprintf (file, " %g", interval > 0 ? bytes * 8 / (1e6 * interval) : 0);
+          }
+        std::fprintf (file, "\n");
+      }
+    return std::fclose (file) == 0;
+  }
+
+private:
+  std::vector<std::string> m_variants; //!< Label of each flow
+  std::vector<uint64_t> m_current;     //!< Bytes of each flow in the open interval
+  std::vector<uint64_t> m_total;       //!< Bytes of each flow in the closed intervals
+  std::vector<double> m_times;         //!< End of each closed interval (s)
+  std::vector<uint64_t> m_bytes;       //!< Bytes per interval and flow, row-major
+  double m_start;                      //!< Start of the first interval (s)
+};
+
+} // namespace ns3
+
+#endif /* GOODPUT_MATRIX_H */
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "goodput-monitor.h"
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("GoodputMonitor");
+
+GoodputMonitor::GoodputMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+GoodputMonitor::~GoodputMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+  m_event.Cancel ();
+  Disconnect ();
+}
+
+uint32_t
+GoodputMonitor::Add (Ptr<Application> sink, const std::string &variant)
+{
+  NS_LOG_FUNCTION (this << sink << variant);
+  std::unique_ptr<Flow> flow (new Flow);
+  flow->matrix = &m_matrix;
+  flow->index = m_matrix.AddFlow (variant);
+  flow->sink = sink;
+  bool connected = sink->TraceConnectWithoutContext (
+    "Rx", MakeBoundCallback (&GoodputMonitor::Receive, flow.get ()));
+  NS_ABORT_MSG_UNLESS (connected, "GoodputMonitor: " << sink << " has no Rx trace");
+  m_flows.push_back (std::move (flow));
+  return m_flows.back ()->index;
+}
+
+void
+GoodputMonitor::Start (Time interval, Time duration)
+{
+  NS_LOG_FUNCTION (this << interval << duration);
+  NS_ABORT_MSG_UNLESS (interval.IsStrictlyPositive (), "GoodputMonitor: bad interval");
+  m_interval = interval;
+  m_lastSample = Simulator::Now ();
+  size_t intervals = 0;
+  if (duration.IsStrictlyPositive ())
+    {
+      intervals = duration.GetInteger () / interval.GetInteger () + 1;
+    }
+  m_matrix.Start (m_lastSample.GetSeconds (), intervals);
+  m_event.Cancel ();
+  m_event = Simulator::Schedule (m_interval, &GoodputMonitor::Sample, this);
+}
+
+void
+GoodputMonitor::Sample ()
+{
+  m_lastSample = Simulator::Now ();
+  m_matrix.Sample (m_lastSample.GetSeconds ());
+  m_event = Simulator::Schedule (m_interval, &GoodputMonitor::Sample, this);
+}
+
+void
+GoodputMonitor::Stop ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_event.IsRunning () && Simulator::Now () > m_lastSample)
+    {
+      m_lastSample = Simulator::Now ();
+      m_matrix.Sample (m_lastSample.GetSeconds ());
+    }
+  m_event.Cancel ();
+  Disconnect ();
+}
+
+void
+GoodputMonitor::Disconnect ()
+{
+  // The sinks hold raw Flow pointers, which die with the monitor
+  for (const std::unique_ptr<Flow> &flow : m_flows)
+    {
+      if (flow->sink != 0)
+        {
+          flow->sink->TraceDisconnectWithoutContext (
+            "Rx", MakeBoundCallback (&GoodputMonitor::Receive, flow.get ()));
+          flow->sink = 0;
+        }
+    }
+}
+
+const GoodputMatrix &
+GoodputMonitor::GetMatrix () const
+{
+  return m_matrix;
+}
+
+void
+GoodputMonitor::Receive (Flow *flow, Ptr<const Packet> packet, const Address &from)
+{
+  flow->matrix->Receive (flow->index, packet->GetSize ());
+}
+
+} // namespace ns3
@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef GOODPUT_MONITOR_H
+#define GOODPUT_MONITOR_H
+
+#include "goodput-matrix.h"
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Goodput of every flow over time, from the Rx trace of its sink
+ *
+ * Works with any application that has an Rx trace source with the
+ * PacketSink signature. The bytes go into a GoodputMatrix, sampled every
+ * interval from one event.
+ *
+ * \code
+ *   GoodputMonitor monitor;
+ *   monitor.Add (sinkApps.Get (i), "ns3::TcpLibra");
+ *   Simulator::Schedule (Seconds (1), &GoodputMonitor::Start, &monitor, Seconds (0.1),
+ *                        Seconds (10));
+ *   Simulator::Run ();
+ *   monitor.Stop ();
+ *   monitor.GetMatrix ().Write ("Task_B/goodput.txt");
+ * \endcode
+ */
+class GoodputMonitor
+{
+public:
+  GoodputMonitor ();
+  ~GoodputMonitor ();
+
+  GoodputMonitor (const GoodputMonitor&) = delete;
+  GoodputMonitor& operator= (const GoodputMonitor&) = delete;
+
+  /**
+   * \brief Count the bytes received by a sink
+   * \param sink the receiving application
+   * \param variant label of the flow in the output and statistics
+   * \return the index of the flow
+   */
+  uint32_t Add (Ptr<Application> sink, const std::string &variant);
+
+  /**
+   * \brief Start the first interval now and sample every interval
+   * \param interval time between samples
+   * \param duration expected sampling time, to size the matrix once
+   */
+  void Start (Time interval, Time duration = Time ());
+
+  /**
+   * \brief Stop sampling, closing the current interval if it is not empty
+   *
+   * Also disconnects the sinks, so the monitor may be destroyed before them.
+   */
+  void Stop ();
+
+  /// \return the samples so far
+  const GoodputMatrix &GetMatrix () const;
+
+private:
+  /// A monitored sink
+  struct Flow
+  {
+    GoodputMatrix *matrix; //!< Matrix of the monitor
+    uint32_t index;        //!< Column of the flow
+    Ptr<Application> sink; //!< The sink, null once disconnected
+  };
+
+  /// Disconnect the Rx trace of every sink still connected
+  void Disconnect ();
+
+  /// Close the current interval and schedule the next sample
+  void Sample ();
+
+  /**
+   * \brief Rx trace sink
+   * \param flow the flow
+   * \param packet the packet received
+   * \param from its sender
+   */
+  static void Receive (Flow *flow, Ptr<const Packet> packet, const Address &from);
+
+  GoodputMatrix m_matrix;                     //!< Samples
+  std::vector<std::unique_ptr<Flow> > m_flows; //!< Monitored sinks
+  Time m_interval;                            //!< Sampling interval
+  Time m_lastSample;                          //!< End of the last closed interval
+  EventId m_event;                            //!< Next sample
+};
+
+} // namespace ns3
+
+#endif /* GOODPUT_MONITOR_H */
@@ -0,0 +1,198 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef QUEUE_MONITOR_BUFFER_H
+#define QUEUE_MONITOR_BUFFER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief File header of a binary queue length log
+ *
+ * The header is followed by blocks, each a uint32_t count n and then
+ * three columns of n entries: time (double, s), packets in the queue
+ * (uint32_t) and average packets (double). Host byte order.
+ */
+struct QueueMonitorHeader
+{
+  char magic[4];     //!< "QMON"
+  uint16_t version;  //!< Format version, 1
+  uint16_t reserved; //!< Zero
+};
+
+static_assert (sizeof (QueueMonitorHeader) == 8, "queue log header layout");
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Queue length samples of one queue, buffered and written in blocks
+ *
+ * Samples go into preallocated columns and reach the files only when the
+ * columns are full or on Flush, which keeps the files open in between.
+ * As text, they are the "time packets" lines of <prefix>.plotme and the
+ * "time average" lines of <prefix>_avg.plotme; as binary, QueueMonitorHeader
+ * blocks in <prefix>.bin.
+ */
+class QueueMonitorBuffer
+{
+public:
+  /// Output format
+  enum Format
+  {
+    TEXT,   //!< Two .plotme files
+    BINARY, //!< One .bin file
+  };
+
+  /**
+   * \param capacity samples held before a write
+   */
+  explicit QueueMonitorBuffer (size_t capacity = 4096)
+    : m_count (0),
+      m_format (TEXT),
+      m_plot (nullptr),
+      m_avgPlot (nullptr)
+  {
+    m_time.resize (capacity);
+    m_packets.resize (capacity);
+    m_average.resize (capacity);
+  }
+
+  ~QueueMonitorBuffer () { Close (); }
+
+  QueueMonitorBuffer (const QueueMonitorBuffer&) = delete;
+  QueueMonitorBuffer& operator= (const QueueMonitorBuffer&) = delete;
+
+  /**
+   * \brief Create the output files
+   * \param prefix path without extension
+   * \param format text or binary
+   * \return true on success
+   */
+  bool Open (const std::string &prefix, Format format)
+  {
+    Close ();
+    m_format = format;
+    if (format == BINARY)
+      {
+        m_plot = std::fopen ((prefix + ".bin").c_str (), "wb");
+        if (m_plot == nullptr)
+          {
+            return false;
+          }
+        QueueMonitorHeader header;
+        std::memcpy (header.magic, "QMON", 4);
+        header.version = 1;
+        header.reserved = 0;
+        std::fwrite (&header, sizeof (header), 1, m_plot);
+        return true;
+      }
+    m_plot = std::fopen ((prefix + ".plotme").c_str (), "w");
+    m_avgPlot = std::fopen ((prefix + "_avg.plotme").c_str (), "w");
+    if (m_plot == nullptr || m_avgPlot == nullptr)
+      {
+        Close ();
+        return false;
+      }
+    return true;
+  }
+
+  /// \return true if the files are open
+  bool IsOpen () const
+  {
+    return m_plot != nullptr;
+  }
+
+  /**
+   * \brief Record one sample, writing the columns out if they are full
+   * \param time simulation time (s)
+   * \param packets packets in the queue
+   * \param average average packets in the queue so far
+   */
+  void Append (double time, uint32_t packets, double average)
+  {
+    m_time[m_count] = time;
+    m_packets[m_count] = packets;
+    m_average[m_count] = average;
+    if (++m_count == m_time.size ())
+      {
+        Flush ();
+      }
+  }
+
+  /// Write the buffered samples
+  void Flush ()
+  {
+    if (m_plot == nullptr || m_count == 0)
+      {
+        m_count = 0;
+        return;
+      }
+    if (m_format == BINARY)
+      {
+        uint32_t count = static_cast<uint32_t> (m_count);
+        std::fwrite (&count, sizeof (count), 1, m_plot);
+        std::fwrite (m_time.data (), sizeof (double), m_count, m_plot);
+        std::fwrite (m_packets.data (), sizeof (uint32_t), m_count, m_plot);
+        std::fwrite (m_average.data (), sizeof (double), m_count, m_plot);
+      }
+    else
+      {
+        for (size_t i = 0; i < m_count; ++i)
+          {
+            std::fprintf (m_plot, "%g %u\n", m_time[i], m_packets[i]);
+            std::fprintf (m_avgPlot, "%g %g\n", m_time[i], m_average[i]);
+          }
+      }
+    m_count = 0;
+  }
+
+  /// Write the buffered samples and close the files
+  void Close ()
+  {
+    Flush ();
+    if (m_plot != nullptr)
+      {
+        std::fclose (m_plot);
+        m_plot = nullptr;
+      }
+    if (m_avgPlot != nullptr)
+      {
+        std::fclose (m_avgPlot);
+        m_avgPlot = nullptr;
+      }
+  }
+
+private:
+  std::vector<double> m_time;      //!< Sample times (s)
+  std::vector<uint32_t> m_packets; //!< Packets in the queue
+  std::vector<double> m_average;   //!< Average packets so far
+  size_t m_count;                  //!< Samples buffered
+  Format m_format;                 //!< Output format
+  std::FILE *m_plot;               //!< <prefix>.plotme or <prefix>.bin
+  std::FILE *m_avgPlot;            //!< <prefix>_avg.plotme, null for binary
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_MONITOR_BUFFER_H */
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "queue-monitor.h"
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("QueueMonitor");
+
+QueueMonitor::Entry::Entry (size_t bufferSize)
+  : buffer (bufferSize),
+    samples (0),
+    sum (0),
+    lastPackets (0),
+    area (0)
+{
+}
+
+QueueMonitor::QueueMonitor (QueueMonitorBuffer::Format format, size_t bufferSize)
+  : m_format (format),
+    m_bufferSize (bufferSize),
+    m_tracing (false),
+    m_connected (false)
+{
+  NS_LOG_FUNCTION (this << format << bufferSize);
+}
+
+QueueMonitor::~QueueMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+uint32_t
+QueueMonitor::Add (Ptr<QueueDisc> queue, const std::string &prefix)
+{
+  NS_LOG_FUNCTION (this << queue << prefix);
+  NS_ABORT_MSG_IF (m_tracing, "QueueMonitor: add the queues before StartTracing");
+  std::unique_ptr<Entry> entry (new Entry (m_bufferSize));
+  entry->queue = queue;
+  NS_ABORT_MSG_UNLESS (entry->buffer.Open (prefix, m_format),
+                       "QueueMonitor: cannot create " << prefix);
+  m_entries.push_back (std::move (entry));
+  return m_entries.size () - 1;
+}
+
+void
+QueueMonitor::StartSampling (Time interval)
+{
+  NS_LOG_FUNCTION (this << interval);
+  m_interval = interval;
+  m_event.Cancel ();
+  m_event = Simulator::ScheduleNow (&QueueMonitor::Sample, this);
+}
+
+void
+QueueMonitor::Sample ()
+{
+  double now = Simulator::Now ().GetSeconds ();
+  for (const std::unique_ptr<Entry> &entry : m_entries)
+    {
+      uint32_t packets = entry->queue->GetCurrentSize ().GetValue ();
+      entry->sum += packets;
+      entry->samples++;
+      entry->buffer.Append (now, packets, entry->sum / entry->samples);
+    }
+  m_event = Simulator::Schedule (m_interval, &QueueMonitor::Sample, this);
+}
+
+void
+QueueMonitor::StartTracing ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_tracing)
+    {
+      return;
+    }
+  m_tracing = true;
+  m_connected = true;
+  for (const std::unique_ptr<Entry> &entry : m_entries)
+    {
+      entry->start = Simulator::Now ();
+      entry->lastChange = entry->start;
+      entry->lastPackets = entry->queue->GetNPackets ();
+      entry->queue->TraceConnectWithoutContext (
+        "PacketsInQueue", MakeBoundCallback (&QueueMonitor::PacketsInQueue, entry.get ()));
+    }
+}
+
+void
+QueueMonitor::PacketsInQueue (Entry *entry, uint32_t oldValue, uint32_t newValue)
+{
+  Time now = Simulator::Now ();
+  entry->area += entry->lastPackets * (now - entry->lastChange).GetSeconds ();
+  entry->lastChange = now;
+  entry->lastPackets = newValue;
+  double elapsed = (now - entry->start).GetSeconds ();
+  double average = elapsed > 0 ? entry->area / elapsed : newValue;
+  entry->buffer.Append (now.GetSeconds (), newValue, average);
+}
+
+double
+QueueMonitor::GetAverage (uint32_t index) const
+{
+  NS_ABORT_MSG_UNLESS (index < m_entries.size (), "QueueMonitor: no queue " << index);
+  const Entry &entry = *m_entries[index];
+  if (m_tracing)
+    {
+      double elapsed = (Simulator::Now () - entry.start).GetSeconds ();
+      double area = entry.area
+        + entry.lastPackets * (Simulator::Now () - entry.lastChange).GetSeconds ();
+      return elapsed > 0 ? area / elapsed : entry.lastPackets;
+    }
+  return entry.samples > 0 ? entry.sum / entry.samples : 0;
+}
+
+void
+QueueMonitor::Close ()
+{
+  NS_LOG_FUNCTION (this);
+  m_event.Cancel ();
+  for (const std::unique_ptr<Entry> &entry : m_entries)
+    {
+      // The sink holds a raw Entry pointer, which must not outlive us
+      if (m_connected)
+        {
+          entry->queue->TraceDisconnectWithoutContext (
+            "PacketsInQueue", MakeBoundCallback (&QueueMonitor::PacketsInQueue, entry.get ()));
+        }
+      entry->buffer.Close ();
+    }
+  m_connected = false;
+}
+
+} // namespace ns3
@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef QUEUE_MONITOR_H
+#define QUEUE_MONITOR_H
+
+#include "queue-monitor-buffer.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/queue-disc.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Logs the length of any number of queue discs
+ *
+ * Either samples every queue at a fixed interval, with one event for all
+ * of them, or records every change of their PacketsInQueue trace. The
+ * average column is the mean of the samples in the first case and the
+ * time-weighted mean in the second. Each queue has its own
+ * QueueMonitorBuffer, written when full and on Close.
+ *
+ * \code
+ *   QueueMonitor monitor;
+ *   monitor.Add (queueDiscs.Get (1), "Task_B/red-queue");
+ *   monitor.StartSampling (Seconds (0.01));
+ *   Simulator::Run ();
+ *   monitor.Close ();
+ * \endcode
+ */
+class QueueMonitor
+{
+public:
+  /**
+   * \param format output format of the queues added later
+   * \param bufferSize samples held per queue before a write
+   */
+  explicit QueueMonitor (QueueMonitorBuffer::Format format = QueueMonitorBuffer::TEXT,
+                         size_t bufferSize = 4096);
+  ~QueueMonitor ();
+
+  QueueMonitor (const QueueMonitor&) = delete;
+  QueueMonitor& operator= (const QueueMonitor&) = delete;
+
+  /**
+   * \brief Monitor a queue disc
+   * \param queue the queue disc
+   * \param prefix output path without extension
+   * \return the index of the queue, for GetAverage
+   */
+  uint32_t Add (Ptr<QueueDisc> queue, const std::string &prefix);
+
+  /**
+   * \brief Sample every queue now and then every interval
+   * \param interval time between samples
+   */
+  void StartSampling (Time interval);
+
+  /// Record every change of the length of the queues, from now on
+  void StartTracing ();
+
+  /**
+   * \param index a value returned by Add
+   * \return the average packets in the queue so far
+   */
+  double GetAverage (uint32_t index) const;
+
+  /// Stop monitoring, write what is buffered and close the files
+  void Close ();
+
+private:
+  /// A monitored queue
+  struct Entry
+  {
+    Ptr<QueueDisc> queue;       //!< The queue disc
+    QueueMonitorBuffer buffer;  //!< Its samples
+    uint64_t samples;           //!< Samples taken
+    double sum;                 //!< Sum of the samples
+    Time start;                 //!< Start of tracing
+    Time lastChange;            //!< Time of the last length change
+    uint32_t lastPackets;       //!< Length since then
+    double area;                //!< Integral of the length until then (packet s)
+
+    /// \param bufferSize samples held before a write
+    explicit Entry (size_t bufferSize);
+  };
+
+  /// Sample every queue and schedule the next sample
+  void Sample ();
+
+  /**
+   * \brief PacketsInQueue trace sink
+   * \param entry the queue
+   * \param oldValue previous length
+   * \param newValue new length
+   */
+  static void PacketsInQueue (Entry *entry, uint32_t oldValue, uint32_t newValue);
+
+  std::vector<std::unique_ptr<Entry> > m_entries; //!< Monitored queues
+  QueueMonitorBuffer::Format m_format;            //!< Output format
+  size_t m_bufferSize;                            //!< Samples held per queue
+  Time m_interval;                                //!< Sampling interval
+  EventId m_event;                                //!< Next sample
+  bool m_tracing;                                 //!< Averages are time-weighted
+  bool m_connected;                               //!< PacketsInQueue connected, until Close
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_MONITOR_H */
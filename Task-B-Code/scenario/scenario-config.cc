@@ -0,0 +1,299 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "scenario-config.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace ns3 {
+
+std::string
+ScenarioStatement::Get (const std::string &name, const std::string &fallback) const
+{
+  std::map<std::string, std::string>::const_iterator it = options.find (name);
+  return it == options.end () ? fallback : it->second;
+}
+
+bool
+ScenarioStatement::Has (const std::string &name) const
+{
+  return options.count (name) > 0;
+}
+
+/* Replace ${name} by the parameter value; false on an unknown parameter */
+static bool
+Expand (const std::string &text, const std::map<std::string, std::string> &params,
+        std::string &out, std::string &unknown)
+{
+  out.clear ();
+  size_t pos = 0;
+  while (pos < text.size ())
+    {
+      size_t start = text.find ("${", pos);
+      if (start == std::string::npos)
+        {
+          out += text.substr (pos);
+          break;
+        }
+      size_t end = text.find ('}', start);
+      if (end == std::string::npos)
+        {
+          unknown = text.substr (start);
+          return false;
+        }
+      out += text.substr (pos, start - pos);
+      std::string name = text.substr (start + 2, end - start - 2);
+      std::map<std::string, std::string>::const_iterator it = params.find (name);
+      if (it == params.end ())
+        {
+          unknown = name;
+          return false;
+        }
+      out += it->second;
+      pos = end + 1;
+    }
+  return true;
+}
+
+/* A when= or unless= value is false if it is empty, 0, false, no or off */
+static bool
+IsTrue (const std::string &text)
+{
+  if (text.empty () || text == "false" || text == "no" || text == "off")
+    {
+      return false;
+    }
+  char *end = 0;
+  double value = std::strtod (text.c_str (), &end);
+  return *end != '\0' || value != 0;
+}
+
+bool
+ScenarioConfig::Load (const std::string &path,
+                      const std::map<std::string, std::string> &overrides, std::string &error)
+{
+  std::ifstream in (path.c_str ());
+  if (!in)
+    {
+      error = "cannot open " + path;
+      return false;
+    }
+
+  m_statements.clear ();
+  m_params.clear ();
+  std::string raw;
+  uint32_t line = 0;
+  while (std::getline (in, raw))
+    {
+      ++line;
+      std::stringstream where;
+      where << path << ":" << line << ": ";
+
+      size_t comment = raw.find ('#');
+      if (comment != std::string::npos)
+        {
+          raw.erase (comment);
+        }
+      std::string text;
+      std::string unknown;
+      if (!Expand (raw, m_params, text, unknown))
+        {
+          error = where.str () + "unknown parameter " + unknown;
+          return false;
+        }
+
+      std::istringstream words (text);
+      ScenarioStatement statement;
+      statement.line = line;
+      if (!(words >> statement.keyword))
+        {
+          continue;
+        }
+
+      std::string word;
+      while (words >> word)
+        {
+          size_t eq = word.find ('=');
+          bool positional = statement.keyword == "default" || statement.keyword == "param";
+          bool condition = word.compare (0, 5, "when=") == 0
+                           || word.compare (0, 7, "unless=") == 0;
+          if ((positional && !condition) || eq == std::string::npos || eq == 0)
+            {
+              statement.args.push_back (word);
+            }
+          else
+            {
+              statement.options[word.substr (0, eq)] = word.substr (eq + 1);
+            }
+        }
+
+      if (statement.keyword == "param")
+        {
+          if (statement.args.size () != 2)
+            {
+              error = where.str () + "expected param <name> <default>";
+              return false;
+            }
+          std::map<std::string, std::string>::const_iterator it =
+            overrides.find (statement.args[0]);
+          m_params[statement.args[0]] = it == overrides.end () ? statement.args[1] : it->second;
+          continue;
+        }
+      bool keep = true;
+      if (statement.Has ("when"))
+        {
+          keep = IsTrue (statement.Get ("when"));
+          statement.options.erase ("when");
+        }
+      if (statement.Has ("unless"))
+        {
+          keep = keep && !IsTrue (statement.Get ("unless"));
+          statement.options.erase ("unless");
+        }
+      if (!keep)
+        {
+          continue;
+        }
+      m_statements.push_back (statement);
+    }
+
+  for (std::map<std::string, std::string>::const_iterator it = overrides.begin ();
+       it != overrides.end (); ++it)
+    {
+      if (m_params.count (it->first) == 0)
+        {
+          error = path + ": no parameter " + it->first;
+          return false;
+        }
+    }
+  return true;
+}
+
+const std::vector<ScenarioStatement> &
+ScenarioConfig::GetStatements () const
+{
+  return m_statements;
+}
+
+const std::map<std::string, std::string> &
+ScenarioConfig::GetParams () const
+{
+  return m_params;
+}
+
+std::vector<std::string>
+SplitScenarioList (const std::string &text)
+{
+  std::vector<std::string> items;
+  std::string item;
+  std::istringstream in (text);
+  while (std::getline (in, item, ','))
+    {
+      items.push_back (item);
+    }
+  return items;
+}
+
+/* Parse an unsigned index, the whole string */
+static bool
+ParseIndex (const std::string &text, uint32_t &value)
+{
+  if (text.empty () || text.find_first_not_of ("0123456789") != std::string::npos)
+    {
+      return false;
+    }
+  value = static_cast<uint32_t> (std::strtoul (text.c_str (), 0, 10));
+  return true;
+}
+
+bool
+ParseScenarioRefs (const std::string &text, std::vector<ScenarioRef> &refs)
+{
+  std::vector<std::string> items = SplitScenarioList (text);
+  for (size_t i = 0; i < items.size (); ++i)
+    {
+      const std::string &item = items[i];
+      ScenarioRef ref;
+      ref.first = 0;
+      ref.last = UINT32_MAX;
+      size_t open = item.find ('[');
+      if (open == std::string::npos)
+        {
+          ref.group = item;
+        }
+      else
+        {
+          if (item[item.size () - 1] != ']')
+            {
+              return false;
+            }
+          ref.group = item.substr (0, open);
+          std::string range = item.substr (open + 1, item.size () - open - 2);
+          size_t colon = range.find (':');
+          if (colon == std::string::npos)
+            {
+              if (!ParseIndex (range, ref.first))
+                {
+                  return false;
+                }
+              ref.last = ref.first + 1;
+            }
+          else
+            {
+              std::string first = range.substr (0, colon);
+              std::string last = range.substr (colon + 1);
+              if ((!first.empty () && !ParseIndex (first, ref.first))
+                  || (!last.empty () && !ParseIndex (last, ref.last)))
+                {
+                  return false;
+                }
+            }
+        }
+      if (ref.group.empty ())
+        {
+          return false;
+        }
+      refs.push_back (ref);
+    }
+  return !items.empty ();
+}
+
+bool
+ParseScenarioSeconds (const std::string &text, double &seconds)
+{
+  seconds = 0;
+  std::istringstream in (text);
+  std::string term;
+  bool any = false;
+  while (std::getline (in, term, '+'))
+    {
+      char *end = 0;
+      double value = std::strtod (term.c_str (), &end);
+      if (term.empty () || *end != '\0')
+        {
+          return false;
+        }
+      seconds += value;
+      any = true;
+    }
+  return any;
+}
+
+} // namespace ns3
@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef SCENARIO_CONFIG_H
+#define SCENARIO_CONFIG_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief One line of a scenario file
+ *
+ * A line is a keyword followed by positional arguments and name=value
+ * options, separated by blanks; '#' starts a comment. Arguments of
+ * "default" lines are all positional, since attribute values may contain
+ * '=' themselves. Any line may end with when=<value> or unless=<value>;
+ * a value is false when it is empty, 0, false, no or off.
+ */
+struct ScenarioStatement
+{
+  std::string keyword;                         //!< First word of the line
+  std::vector<std::string> args;               //!< Positional arguments
+  std::map<std::string, std::string> options;  //!< name=value options
+  uint32_t line;                               //!< Line number, for errors
+
+  /**
+   * \param name option name
+   * \param fallback value if the option is absent
+   * \return the option value
+   */
+  std::string Get (const std::string &name, const std::string &fallback = "") const;
+  /**
+   * \param name option name
+   * \return true if the option is present
+   */
+  bool Has (const std::string &name) const;
+};
+
+/**
+ * \brief A scenario file, read and expanded
+ *
+ * "param <name> <default>" lines declare parameters; ${name} anywhere later
+ * in the file is replaced by the value given on the command line, else by
+ * the default. The remaining lines are returned in file order, for the
+ * scenario engine to execute.
+ */
+class ScenarioConfig
+{
+public:
+  /**
+   * \brief Read and expand a scenario file
+   * \param path the file
+   * \param overrides parameter values that replace the file defaults
+   * \param error set to a message with the line number on failure
+   * \return true on success
+   */
+  bool Load (const std::string &path, const std::map<std::string, std::string> &overrides,
+             std::string &error);
+
+  /// \return the statements of the file, parameters excluded
+  const std::vector<ScenarioStatement> &GetStatements () const;
+  /// \return the parameters and the values they took
+  const std::map<std::string, std::string> &GetParams () const;
+
+private:
+  std::vector<ScenarioStatement> m_statements;  //!< Statements in file order
+  std::map<std::string, std::string> m_params;  //!< Parameter values
+};
+
+/**
+ * \brief A reference to members of a named group
+ *
+ * Written group (all members), group[i] or group[a:b] (a to b - 1; either
+ * bound may be left out). Several references are joined with commas.
+ */
+struct ScenarioRef
+{
+  std::string group;  //!< Group or segment name
+  uint32_t first;     //!< First member
+  uint32_t last;      //!< One past the last member, UINT32_MAX for all
+};
+
+/**
+ * \brief Parse a comma-separated list of references
+ * \param text the list
+ * \param refs the references, appended
+ * \return false if the list is malformed
+ */
+bool ParseScenarioRefs (const std::string &text, std::vector<ScenarioRef> &refs);
+
+/**
+ * \brief Parse a time in seconds, allowing a sum such as "10+1"
+ * \param text the value
+ * \param seconds the result
+ * \return false if the value is malformed
+ */
+bool ParseScenarioSeconds (const std::string &text, double &seconds);
+
+/**
+ * \brief Split a comma-separated list
+ * \param text the list
+ * \return its items, empty ones included
+ */
+std::vector<std::string> SplitScenarioList (const std::string &text);
+
+} // namespace ns3
+
+#endif /* SCENARIO_CONFIG_H */
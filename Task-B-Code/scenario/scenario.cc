@@ -0,0 +1,1069 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Scenario engine: builds the network and workload described by a scenario
+ * file, runs it and writes every output into one run directory.
+ *
+ *   ./waf --run "scratch/scenario --config=scratch/scenario/configs/wired-b.scn
+ *                --runDir=runs/0001 --param=flow=10 --param=bottleneckRate=50Mbps"
+ *
+ * The file is executed line by line, in order, so a file that follows the
+ * creation order of a hand-written main() reproduces its node ids, random
+ * streams and results. "libra-bench.sh scn" checks that for configs/: it
+ * runs each file next to the main it stands for and diffs the summary
+ * lines both print. Statements:
+ *
+ *   param <name> <default>              ${name} later in the file, --param=name=value
+ *   simulation time=<s> stop=<s>        goodput averaging time and stop time
+ *   default <attribute> <value>         Config::SetDefault, unless given on the command line
+ *   nodes <group> <count>               create nodes
+ *   p2p <segment> <nodes> [rate= delay= queue=]
+ *   csma <segment> <nodes> [rate= delay= queue=]
+ *   wifi <segment> ap=<node> sta=<nodes> [standard= range= manager= ssid=]
+ *   lrwpan <segment> <nodes> [pan= range=]
+ *   sixlowpan <segment> [meshUnderRadius=]
+ *   mobility <nodes> [minX= minY= deltaX= deltaY= width=]
+ *   stack <nodes>                       internet stack, IPv4 and IPv6
+ *   qdisc <segment> <type> [Attribute=value...]
+ *   address <segment> <network> <mask>
+ *   address6 <segment> <prefix> <length> [router=<index>]
+ *   routing [print=<s> file=]           global IPv4 routing
+ *   errormodel <name> [type=rate|burst rate= unit=packet|byte|bit burst=]
+ *   attach <errormodel> <devices>       receive error model, post reception on wifi
+ *   flows src=<nodes> dst=<nodes> [count= net=<segment> variant=<types> port= | ports=
+ *         rate= size= on= off= start= stop= sinkStart= sinkStop=]
+ *   goodput [start= interval= file=]    goodput of the last flow, as the mains report it
+ *   flowgoodput [start= interval= file=]  goodput of every flow over time, with per-variant
+ *                                         min/median/max in the summary
+ *   queue <segment>[i] [trace=<s> events= format=text|binary file=]
+ *                                       queue disc reported in the summary, sampled
+ *                                       every trace= seconds unless 0, or logged on
+ *                                       every change with events=true
+ *   flowmonitor [file= xml=true|false stats=<s> fairness=<id>]
+ *                                       flowstats.json always, the XML unless xml=false,
+ *                                       flowstats.csv rows every stats= seconds if set
+ *   summary [capacity= unit=Mbit/s|Kbit/s]
+ *
+ * Nodes are written group, group[i] or group[a:b], joined with commas;
+ * devices the same way on segment names. Any statement may end with
+ * when=<value> or unless=<value> to make it conditional on a parameter.
+ */
+
+#include "scenario-config.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/lr-wpan-module.h"
+#include "ns3/sixlowpan-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/system-path.h"
+#include "ns3/queue-monitor.h"
+#include "ns3/goodput-monitor.h"
+#include "ns3/flow-stats-collector.h"
+
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+
+NS_LOG_COMPONENT_DEFINE ("Scenario");
+
+using namespace ns3;
+
+/* Command line parameter overrides, --param=name=value */
+std::map<std::string, std::string> paramOverrides;
+
+bool
+AddParam (std::string text)
+{
+  size_t eq = text.find ('=');
+  if (eq == std::string::npos || eq == 0)
+    {
+      return false;
+    }
+  paramOverrides[text.substr (0, eq)] = text.substr (eq + 1);
+  return true;
+}
+
+/**
+ * \brief Builds and runs one scenario file
+ */
+class Scenario
+{
+public:
+  /**
+   * \param path the scenario file, for error messages
+   * \param runDir directory that receives every output
+   * \param argc command line
+   * \param argv command line
+   */
+  Scenario (const std::string &path, const std::string &runDir, int argc, char *argv[]);
+
+  /**
+   * \brief Execute the statements, run the simulation and write the summary
+   * \param config the scenario
+   */
+  void Run (const ScenarioConfig &config);
+
+private:
+  /// A link, LAN or radio segment with what was installed on it
+  struct Segment
+  {
+    NodeContainer nodes;               //!< Nodes, in device order
+    NetDeviceContainer devices;        //!< Devices (6LoWPAN ones once installed)
+    Ipv4InterfaceContainer v4;         //!< IPv4 interfaces
+    Ipv6InterfaceContainer v6;         //!< IPv6 interfaces
+    QueueDiscContainer queueDiscs;     //!< Root queue discs
+  };
+
+  /// A flow and its sink
+  struct Flow
+  {
+    std::string variant;               //!< Congestion control, empty for the default
+    Ptr<PacketSink> sink;              //!< Receiving application
+  };
+
+  /// \return "file:line: " for error messages
+  std::string Where (const ScenarioStatement &s) const;
+  /// \return the path of an output file in the run directory
+  std::string Output (const std::string &name) const;
+  /// \return the nodes a reference list names
+  NodeContainer Nodes (const ScenarioStatement &s, const std::string &text) const;
+  /// \return the devices a reference list names
+  NetDeviceContainer Devices (const ScenarioStatement &s, const std::string &text) const;
+  /// \return the segment called name
+  Segment &GetSegment (const ScenarioStatement &s, const std::string &name);
+  /// \return a new segment called name
+  Segment &NewSegment (const ScenarioStatement &s, const std::string &name);
+  /// \return the seconds value of an option
+  double OptionSeconds (const ScenarioStatement &s, const std::string &name, double fallback) const;
+  /// \return the address flows to node use
+  Address FlowAddress (const ScenarioStatement &s, Ptr<Node> node, uint16_t port);
+
+  void DoSimulation (const ScenarioStatement &s);
+  void DoDefault (const ScenarioStatement &s);
+  void DoNodes (const ScenarioStatement &s);
+  void DoP2p (const ScenarioStatement &s);
+  void DoCsma (const ScenarioStatement &s);
+  void DoWifi (const ScenarioStatement &s);
+  void DoLrWpan (const ScenarioStatement &s);
+  void DoSixLowPan (const ScenarioStatement &s);
+  void DoMobility (const ScenarioStatement &s);
+  void DoStack (const ScenarioStatement &s);
+  void DoQdisc (const ScenarioStatement &s);
+  void DoAddress (const ScenarioStatement &s);
+  void DoAddress6 (const ScenarioStatement &s);
+  void DoRouting (const ScenarioStatement &s);
+  void DoErrorModel (const ScenarioStatement &s);
+  void DoAttach (const ScenarioStatement &s);
+  void DoFlows (const ScenarioStatement &s);
+  void DoGoodput (const ScenarioStatement &s);
+  void DoFlowGoodput (const ScenarioStatement &s);
+  void DoQueue (const ScenarioStatement &s);
+  void DoFlowMonitor (const ScenarioStatement &s);
+  void DoSummary (const ScenarioStatement &s);
+
+  /// Print and log the goodput of the last flow, then reschedule
+  void CalculateGoodput (Time interval);
+  /// Write the summary to stdout and summary.txt
+  void Report (int64_t wallClockMs) const;
+  /// \return Jain's fairness index of the flows running variant, all if empty
+  double JainIndex (const std::string &variant) const;
+
+  std::string m_runDir;                          //!< Output directory
+  std::string m_path;                            //!< Scenario file, for errors
+  std::vector<std::string> m_commandLine;        //!< Arguments, to spot attribute overrides
+  std::map<std::string, std::string> m_params;   //!< Parameters of the run
+  std::map<std::string, NodeContainer> m_groups; //!< Node groups by name
+  std::map<std::string, Segment> m_segments;     //!< Segments by name
+  std::map<std::string, Ptr<ErrorModel> > m_errorModels; //!< Error models by name
+  std::vector<Flow> m_flows;                     //!< Flows in creation order
+  double m_time;                                 //!< Goodput averaging time (s)
+  double m_stop;                                 //!< Stop time (s)
+
+  std::ofstream m_goodput;                       //!< Goodput samples of the last flow
+  uint64_t m_lastTotalRx;                        //!< Last flow bytes at the last sample
+  std::unique_ptr<GoodputMonitor> m_goodputMonitor; //!< Per-flow goodput, if sampled
+  std::string m_goodputFile;                     //!< Per-flow goodput output
+
+  Ptr<QueueDisc> m_queue;                        //!< Reported queue disc
+  std::vector<std::unique_ptr<QueueMonitor> > m_queueMonitors; //!< Traced queues
+
+  FlowMonitorHelper m_flowHelper;                //!< Flow monitor, if installed
+  Ptr<FlowMonitor> m_flowMonitor;                //!< Installed flow monitor
+  std::string m_flowMonitorFile;                 //!< Flow monitor XML output, none if empty
+  std::unique_ptr<FlowStatsCollector> m_flowStats; //!< Flow statistics of the flow monitor
+
+  double m_capacity;                             //!< Bottleneck bit rate, 0 if unknown
+  std::string m_unit;                            //!< Goodput unit of the summary
+};
+
+Scenario::Scenario (const std::string &path, const std::string &runDir, int argc, char *argv[])
+  : m_runDir (runDir),
+    m_path (path),
+    m_time (0),
+    m_stop (0),
+    m_lastTotalRx (0),
+    m_capacity (0),
+    m_unit ("Mbit/s")
+{
+  for (int i = 1; i < argc; ++i)
+    {
+      m_commandLine.push_back (argv[i]);
+    }
+}
+
+std::string
+Scenario::Where (const ScenarioStatement &s) const
+{
+  std::stringstream where;
+  where << m_path << ":" << s.line << ": " << s.keyword << ": ";
+  return where.str ();
+}
+
+std::string
+Scenario::Output (const std::string &name) const
+{
+  return SystemPath::Append (m_runDir, name);
+}
+
+NodeContainer
+Scenario::Nodes (const ScenarioStatement &s, const std::string &text) const
+{
+  std::vector<ScenarioRef> refs;
+  NS_ABORT_MSG_UNLESS (ParseScenarioRefs (text, refs), Where (s) << "bad node list " << text);
+  NodeContainer nodes;
+  for (size_t i = 0; i < refs.size (); ++i)
+    {
+      std::map<std::string, NodeContainer>::const_iterator group = m_groups.find (refs[i].group);
+      NS_ABORT_MSG_IF (group == m_groups.end (), Where (s) << "no node group " << refs[i].group);
+      uint32_t last = std::min (refs[i].last, group->second.GetN ());
+      NS_ABORT_MSG_IF (refs[i].first >= last, Where (s) << "empty node range in " << text);
+      for (uint32_t j = refs[i].first; j < last; ++j)
+        {
+          nodes.Add (group->second.Get (j));
+        }
+    }
+  return nodes;
+}
+
+NetDeviceContainer
+Scenario::Devices (const ScenarioStatement &s, const std::string &text) const
+{
+  std::vector<ScenarioRef> refs;
+  NS_ABORT_MSG_UNLESS (ParseScenarioRefs (text, refs), Where (s) << "bad device list " << text);
+  NetDeviceContainer devices;
+  for (size_t i = 0; i < refs.size (); ++i)
+    {
+      std::map<std::string, Segment>::const_iterator segment = m_segments.find (refs[i].group);
+      NS_ABORT_MSG_IF (segment == m_segments.end (), Where (s) << "no segment " << refs[i].group);
+      uint32_t last = std::min (refs[i].last, segment->second.devices.GetN ());
+      NS_ABORT_MSG_IF (refs[i].first >= last, Where (s) << "empty device range in " << text);
+      for (uint32_t j = refs[i].first; j < last; ++j)
+        {
+          devices.Add (segment->second.devices.Get (j));
+        }
+    }
+  return devices;
+}
+
+Scenario::Segment &
+Scenario::GetSegment (const ScenarioStatement &s, const std::string &name)
+{
+  std::map<std::string, Segment>::iterator it = m_segments.find (name);
+  NS_ABORT_MSG_IF (it == m_segments.end (), Where (s) << "no segment " << name);
+  return it->second;
+}
+
+Scenario::Segment &
+Scenario::NewSegment (const ScenarioStatement &s, const std::string &name)
+{
+  NS_ABORT_MSG_IF (m_segments.count (name) > 0, Where (s) << "segment " << name << " exists");
+  return m_segments[name];
+}
+
+double
+Scenario::OptionSeconds (const ScenarioStatement &s, const std::string &name, double fallback) const
+{
+  if (!s.Has (name))
+    {
+      return fallback;
+    }
+  double seconds;
+  NS_ABORT_MSG_UNLESS (ParseScenarioSeconds (s.Get (name), seconds),
+                       Where (s) << "bad time " << name << "=" << s.Get (name));
+  return seconds;
+}
+
+void
+Scenario::Run (const ScenarioConfig &config)
+{
+  m_params = config.GetParams ();
+  typedef void (Scenario::*Handler) (const ScenarioStatement &s);
+  std::map<std::string, Handler> handlers;
+  handlers["simulation"] = &Scenario::DoSimulation;
+  handlers["default"] = &Scenario::DoDefault;
+  handlers["nodes"] = &Scenario::DoNodes;
+  handlers["p2p"] = &Scenario::DoP2p;
+  handlers["csma"] = &Scenario::DoCsma;
+  handlers["wifi"] = &Scenario::DoWifi;
+  handlers["lrwpan"] = &Scenario::DoLrWpan;
+  handlers["sixlowpan"] = &Scenario::DoSixLowPan;
+  handlers["mobility"] = &Scenario::DoMobility;
+  handlers["stack"] = &Scenario::DoStack;
+  handlers["qdisc"] = &Scenario::DoQdisc;
+  handlers["address"] = &Scenario::DoAddress;
+  handlers["address6"] = &Scenario::DoAddress6;
+  handlers["routing"] = &Scenario::DoRouting;
+  handlers["errormodel"] = &Scenario::DoErrorModel;
+  handlers["attach"] = &Scenario::DoAttach;
+  handlers["flows"] = &Scenario::DoFlows;
+  handlers["goodput"] = &Scenario::DoGoodput;
+  handlers["flowgoodput"] = &Scenario::DoFlowGoodput;
+  handlers["queue"] = &Scenario::DoQueue;
+  handlers["flowmonitor"] = &Scenario::DoFlowMonitor;
+  handlers["summary"] = &Scenario::DoSummary;
+
+  const std::vector<ScenarioStatement> &statements = config.GetStatements ();
+  for (size_t i = 0; i < statements.size (); ++i)
+    {
+      const ScenarioStatement &s = statements[i];
+      std::map<std::string, Handler>::const_iterator handler = handlers.find (s.keyword);
+      NS_ABORT_MSG_IF (handler == handlers.end (), Where (s) << "unknown statement");
+      (this->*handler->second) (s);
+    }
+  NS_ABORT_MSG_UNLESS (m_stop > 0, m_path << ": no simulation statement");
+
+  Simulator::Stop (Seconds (m_stop));
+  SystemWallClockMs wallClock;
+  wallClock.Start ();
+  Simulator::Run ();
+  int64_t wallClockMs = wallClock.End ();
+
+  for (size_t i = 0; i < m_queueMonitors.size (); ++i)
+    {
+      m_queueMonitors[i]->Close ();
+    }
+  if (m_goodputMonitor)
+    {
+      m_goodputMonitor->Stop ();
+      m_goodputMonitor->GetMatrix ().Write (Output (m_goodputFile));
+    }
+  if (m_flowMonitor)
+    {
+      if (!m_flowMonitorFile.empty ())
+        {
+          m_flowMonitor->SerializeToXmlFile (Output (m_flowMonitorFile), false, false);
+        }
+      m_flowStats->Finish (Output ("flowstats.json"));
+    }
+  Report (wallClockMs);
+  Simulator::Destroy ();
+}
+
+void
+Scenario::DoSimulation (const ScenarioStatement &s)
+{
+  m_time = OptionSeconds (s, "time", 0);
+  m_stop = OptionSeconds (s, "stop", m_time);
+  NS_ABORT_MSG_UNLESS (m_time > 0 && m_stop > 0, Where (s) << "needs time=");
+}
+
+void
+Scenario::DoDefault (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected default <attribute> <value>");
+  /* --ns3::Type::Attribute=value on the command line wins over the file */
+  std::string flag = "--" + s.args[0] + "=";
+  for (size_t i = 0; i < m_commandLine.size (); ++i)
+    {
+      if (m_commandLine[i].compare (0, flag.size (), flag) == 0)
+        {
+          return;
+        }
+    }
+  Config::SetDefault (s.args[0], StringValue (s.args[1]));
+}
+
+void
+Scenario::DoNodes (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected nodes <group> <count>");
+  NS_ABORT_MSG_IF (m_groups.count (s.args[0]) > 0, Where (s) << "group " << s.args[0] << " exists");
+  NodeContainer nodes;
+  nodes.Create (std::stoul (s.args[1]));
+  m_groups[s.args[0]] = nodes;
+}
+
+void
+Scenario::DoP2p (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected p2p <segment> <nodes>");
+  NodeContainer nodes = Nodes (s, s.args[1]);
+  NS_ABORT_MSG_UNLESS (nodes.GetN () == 2, Where (s) << "a link joins two nodes");
+
+  PointToPointHelper pointToPoint;
+  if (s.Has ("queue"))
+    {
+      pointToPoint.SetQueue (s.Get ("queue"));
+    }
+  if (s.Has ("rate"))
+    {
+      pointToPoint.SetDeviceAttribute ("DataRate", StringValue (s.Get ("rate")));
+    }
+  if (s.Has ("delay"))
+    {
+      pointToPoint.SetChannelAttribute ("Delay", StringValue (s.Get ("delay")));
+    }
+  Segment &segment = NewSegment (s, s.args[0]);
+  segment.nodes = nodes;
+  segment.devices = pointToPoint.Install (nodes);
+}
+
+void
+Scenario::DoCsma (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected csma <segment> <nodes>");
+  NodeContainer nodes = Nodes (s, s.args[1]);
+
+  CsmaHelper csma;
+  if (s.Has ("queue"))
+    {
+      csma.SetQueue (s.Get ("queue"));
+    }
+  if (s.Has ("rate"))
+    {
+      csma.SetChannelAttribute ("DataRate", StringValue (s.Get ("rate")));
+    }
+  if (s.Has ("delay"))
+    {
+      csma.SetChannelAttribute ("Delay", StringValue (s.Get ("delay")));
+    }
+  Segment &segment = NewSegment (s, s.args[0]);
+  segment.nodes = nodes;
+  segment.devices = csma.Install (nodes);
+}
+
+void
+Scenario::DoWifi (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 1 && s.Has ("ap") && s.Has ("sta"),
+                       Where (s) << "expected wifi <segment> ap=<node> sta=<nodes>");
+  NodeContainer ap = Nodes (s, s.Get ("ap"));
+  NodeContainer sta = Nodes (s, s.Get ("sta"));
+
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  if (s.Has ("range"))
+    {
+      channel.AddPropagationLoss ("ns3::RangePropagationLossModel",
+                                  "MaxRange", DoubleValue (std::stod (s.Get ("range"))));
+    }
+  YansWifiPhyHelper phy;
+  phy.SetChannel (channel.Create ());
+
+  std::map<std::string, WifiStandard> standards;
+  standards["80211a"] = WIFI_STANDARD_80211a;
+  standards["80211b"] = WIFI_STANDARD_80211b;
+  standards["80211g"] = WIFI_STANDARD_80211g;
+  standards["80211n_2_4GHZ"] = WIFI_STANDARD_80211n_2_4GHZ;
+  standards["80211n_5GHZ"] = WIFI_STANDARD_80211n_5GHZ;
+  standards["80211ac"] = WIFI_STANDARD_80211ac;
+  standards["80211ax_5GHZ"] = WIFI_STANDARD_80211ax_5GHZ;
+  std::string standard = s.Get ("standard", "80211a");
+  NS_ABORT_MSG_IF (standards.count (standard) == 0, Where (s) << "unknown standard " << standard);
+
+  WifiHelper wifi;
+  wifi.SetRemoteStationManager (s.Get ("manager", "ns3::AarfWifiManager"));
+  wifi.SetStandard (standards[standard]);
+
+  WifiMacHelper mac;
+  Ssid ssid = Ssid (s.Get ("ssid", "ns-3-ssid"));
+  mac.SetType ("ns3::StaWifiMac",
+               "Ssid", SsidValue (ssid),
+               "ActiveProbing", BooleanValue (false));
+  NetDeviceContainer staDevices = wifi.Install (phy, mac, sta);
+  mac.SetType ("ns3::ApWifiMac",
+               "Ssid", SsidValue (ssid));
+  NetDeviceContainer apDevices = wifi.Install (phy, mac, ap);
+
+  /* The AP comes first, so it takes the first address */
+  Segment &segment = NewSegment (s, s.args[0]);
+  segment.nodes.Add (ap);
+  segment.nodes.Add (sta);
+  segment.devices.Add (apDevices);
+  segment.devices.Add (staDevices);
+}
+
+void
+Scenario::DoLrWpan (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected lrwpan <segment> <nodes>");
+  NodeContainer nodes = Nodes (s, s.args[1]);
+
+  /* Without range=, the helper's own channel, with log distance loss */
+  LrWpanHelper lrWpan;
+  if (s.Has ("range"))
+    {
+      Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+      Ptr<RangePropagationLossModel> loss = CreateObject<RangePropagationLossModel> ();
+      loss->SetAttribute ("MaxRange", DoubleValue (std::stod (s.Get ("range"))));
+      channel->AddPropagationLossModel (loss);
+      channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+      lrWpan.SetChannel (channel);
+    }
+  Segment &segment = NewSegment (s, s.args[0]);
+  segment.nodes = nodes;
+  segment.devices = lrWpan.Install (nodes);
+  lrWpan.AssociateToPan (segment.devices, std::stoul (s.Get ("pan", "0")));
+}
+
+void
+Scenario::DoSixLowPan (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 1, Where (s) << "expected sixlowpan <segment>");
+  Segment &segment = GetSegment (s, s.args[0]);
+
+  SixLowPanHelper sixLowPan;
+  segment.devices = sixLowPan.Install (segment.devices);
+  if (s.Has ("meshUnderRadius"))
+    {
+      uint32_t radius = std::stoul (s.Get ("meshUnderRadius"));
+      for (uint32_t i = 0; i < segment.devices.GetN (); i++)
+        {
+          segment.devices.Get (i)->SetAttribute ("UseMeshUnder", BooleanValue (true));
+          segment.devices.Get (i)->SetAttribute ("MeshUnderRadius", UintegerValue (radius));
+        }
+    }
+}
+
+void
+Scenario::DoMobility (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 1, Where (s) << "expected mobility <nodes>");
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "MinX", DoubleValue (std::stod (s.Get ("minX", "0"))),
+                                 "MinY", DoubleValue (std::stod (s.Get ("minY", "0"))),
+                                 "DeltaX", DoubleValue (std::stod (s.Get ("deltaX", "5"))),
+                                 "DeltaY", DoubleValue (std::stod (s.Get ("deltaY", "10"))),
+                                 "GridWidth", UintegerValue (std::stoul (s.Get ("width", "3"))),
+                                 "LayoutType", StringValue ("RowFirst"));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (Nodes (s, s.args[0]));
+}
+
+void
+Scenario::DoStack (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 1, Where (s) << "expected stack <nodes>");
+  InternetStackHelper stack;
+  stack.Install (Nodes (s, s.args[0]));
+}
+
+void
+Scenario::DoQdisc (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected qdisc <segment> <type>");
+  NS_ABORT_MSG_IF (s.options.size () > 4, Where (s) << "at most four attributes");
+  Segment &segment = GetSegment (s, s.args[0]);
+
+  /* Unused slots keep an empty name, which the factory ignores */
+  std::string names[4];
+  StringValue values[4];
+  uint32_t n = 0;
+  for (std::map<std::string, std::string>::const_iterator it = s.options.begin ();
+       it != s.options.end (); ++it, ++n)
+    {
+      names[n] = it->first;
+      values[n] = StringValue (it->second);
+    }
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc (s.args[1], names[0], values[0], names[1], values[1],
+                        names[2], values[2], names[3], values[3]);
+  segment.queueDiscs = tch.Install (segment.devices);
+}
+
+void
+Scenario::DoAddress (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 3,
+                       Where (s) << "expected address <segment> <network> <mask>");
+  Segment &segment = GetSegment (s, s.args[0]);
+  Ipv4AddressHelper address;
+  address.SetBase (s.args[1].c_str (), s.args[2].c_str ());
+  segment.v4 = address.Assign (segment.devices);
+}
+
+void
+Scenario::DoAddress6 (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 3,
+                       Where (s) << "expected address6 <segment> <prefix> <length>");
+  Segment &segment = GetSegment (s, s.args[0]);
+  Ipv6AddressHelper ipv6;
+  ipv6.SetBase (Ipv6Address (s.args[1].c_str ()),
+                Ipv6Prefix (static_cast<uint8_t> (std::stoul (s.args[2]))));
+  segment.v6 = ipv6.Assign (segment.devices);
+  if (s.Has ("router"))
+    {
+      uint32_t router = std::stoul (s.Get ("router"));
+      NS_ABORT_MSG_UNLESS (router < segment.v6.GetN (), Where (s) << "no interface " << router);
+      segment.v6.SetForwarding (router, true);
+      segment.v6.SetDefaultRouteInAllNodes (router);
+    }
+}
+
+void
+Scenario::DoRouting (const ScenarioStatement &s)
+{
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  if (s.Has ("print"))
+    {
+      AsciiTraceHelper asciiTraceHelper;
+      Ptr<OutputStreamWrapper> stream =
+        asciiTraceHelper.CreateFileStream (Output (s.Get ("file", "routing.txt")));
+      Ipv4GlobalRoutingHelper::PrintRoutingTableAllAt (Seconds (OptionSeconds (s, "print", 0)),
+                                                       stream, Time::S);
+    }
+}
+
+void
+Scenario::DoErrorModel (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 1, Where (s) << "expected errormodel <name>");
+  std::string type = s.Get ("type", "rate");
+  Ptr<ErrorModel> model;
+  if (type == "rate")
+    {
+      Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+      if (s.Has ("unit"))
+        {
+          std::map<std::string, RateErrorModel::ErrorUnit> units;
+          units["packet"] = RateErrorModel::ERROR_UNIT_PACKET;
+          units["byte"] = RateErrorModel::ERROR_UNIT_BYTE;
+          units["bit"] = RateErrorModel::ERROR_UNIT_BIT;
+          std::string unit = s.Get ("unit");
+          NS_ABORT_MSG_IF (units.count (unit) == 0, Where (s) << "unknown unit " << unit);
+          em->SetAttribute ("ErrorUnit", EnumValue (units[unit]));
+        }
+      em->SetAttribute ("ErrorRate", DoubleValue (std::stod (s.Get ("rate", "0"))));
+      model = em;
+    }
+  else if (type == "burst")
+    {
+      Ptr<BurstErrorModel> burst = CreateObject<BurstErrorModel> ();
+      burst->SetAttribute ("ErrorRate", DoubleValue (std::stod (s.Get ("rate", "0"))));
+      std::stringstream burstSizeRv;
+      burstSizeRv << "ns3::ConstantRandomVariable[Constant=" << s.Get ("burst", "1") << "]";
+      burst->SetAttribute ("BurstSize", StringValue (burstSizeRv.str ()));
+      model = burst;
+    }
+  else
+    {
+      NS_ABORT_MSG (Where (s) << "unknown type " << type);
+    }
+  m_errorModels[s.args[0]] = model;
+}
+
+void
+Scenario::DoAttach (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 2, Where (s) << "expected attach <errormodel> <devices>");
+  std::map<std::string, Ptr<ErrorModel> >::const_iterator model = m_errorModels.find (s.args[0]);
+  NS_ABORT_MSG_IF (model == m_errorModels.end (), Where (s) << "no error model " << s.args[0]);
+
+  NetDeviceContainer devices = Devices (s, s.args[1]);
+  for (uint32_t i = 0; i < devices.GetN (); i++)
+    {
+      Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (devices.Get (i));
+      if (wifi)
+        {
+          wifi->GetPhy ()->SetPostReceptionErrorModel (model->second);
+        }
+      else
+        {
+          devices.Get (i)->SetAttribute ("ReceiveErrorModel", PointerValue (model->second));
+        }
+    }
+}
+
+Address
+Scenario::FlowAddress (const ScenarioStatement &s, Ptr<Node> node, uint16_t port)
+{
+  if (s.Has ("net"))
+    {
+      /* The node's address on that segment, the global one for IPv6 */
+      Segment &segment = GetSegment (s, s.Get ("net"));
+      for (uint32_t i = 0; i < segment.nodes.GetN (); i++)
+        {
+          if (segment.nodes.Get (i) != node)
+            {
+              continue;
+            }
+          if (segment.v6.GetN () > 0)
+            {
+              return Inet6SocketAddress (segment.v6.GetAddress (i, 1), port);
+            }
+          return InetSocketAddress (segment.v4.GetAddress (i), port);
+        }
+      NS_ABORT_MSG (Where (s) << "node " << node->GetId () << " is not on " << s.Get ("net"));
+    }
+
+  /* Else the first interface after the loopback */
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  if (ipv4 && ipv4->GetNInterfaces () > 1)
+    {
+      return InetSocketAddress (ipv4->GetAddress (1, 0).GetLocal (), port);
+    }
+  Ptr<Ipv6> ipv6 = node->GetObject<Ipv6> ();
+  NS_ABORT_MSG_UNLESS (ipv6 && ipv6->GetNInterfaces () > 1,
+                       Where (s) << "node " << node->GetId () << " has no address");
+  return Inet6SocketAddress (ipv6->GetAddress (1, 1).GetAddress (), port);
+}
+
+void
+Scenario::DoFlows (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.Has ("src") && s.Has ("dst"), Where (s) << "expected src= and dst=");
+  NodeContainer src = Nodes (s, s.Get ("src"));
+  NodeContainer dst = Nodes (s, s.Get ("dst"));
+  uint32_t count = s.Has ("count") ? std::stoul (s.Get ("count"))
+                                   : std::min (src.GetN (), dst.GetN ());
+  NS_ABORT_MSG_IF (count > src.GetN () || count > dst.GetN (),
+                   Where (s) << count << " flows, " << src.GetN () << " sources and "
+                             << dst.GetN () << " sinks");
+
+  /* Variants are handed out in turn, the ports in order from port= */
+  std::vector<std::string> variants;
+  if (s.Has ("variant"))
+    {
+      variants = SplitScenarioList (s.Get ("variant"));
+    }
+  std::vector<std::string> ports;
+  if (s.Has ("ports"))
+    {
+      ports = SplitScenarioList (s.Get ("ports"));
+      NS_ABORT_MSG_IF (ports.size () < count, Where (s) << "fewer ports than flows");
+    }
+  uint32_t basePort = std::stoul (s.Get ("port", "9"));
+
+  for (uint32_t i = 0; i < count; i++)
+    {
+      Flow flow;
+      if (!variants.empty ())
+        {
+          flow.variant = variants[i % variants.size ()];
+          TypeId tid;
+          NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (flow.variant, &tid),
+                               Where (s) << "TypeId " << flow.variant << " not found");
+          std::stringstream specificNode;
+          specificNode << "/NodeList/" << src.Get (i)->GetId ()
+                       << "/$ns3::TcpL4Protocol/SocketType";
+          Config::Set (specificNode.str (), TypeIdValue (tid));
+        }
+      uint16_t port = static_cast<uint16_t> (ports.empty () ? basePort + i : std::stoul (ports[i]));
+      Address remote = FlowAddress (s, dst.Get (i), port);
+
+      Address local;
+      if (Inet6SocketAddress::IsMatchingType (remote))
+        {
+          local = Inet6SocketAddress (Ipv6Address::GetAny (), port);
+        }
+      else
+        {
+          local = InetSocketAddress (Ipv4Address::GetAny (), port);
+        }
+      PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", local);
+      ApplicationContainer sinkApp = sinkHelper.Install (dst.Get (i));
+      flow.sink = StaticCast<PacketSink> (sinkApp.Get (0));
+      sinkApp.Start (Seconds (OptionSeconds (s, "sinkStart", 0)));
+      if (s.Has ("sinkStop"))
+        {
+          sinkApp.Stop (Seconds (OptionSeconds (s, "sinkStop", 0)));
+        }
+
+      OnOffHelper server ("ns3::TcpSocketFactory", remote);
+      if (s.Has ("size"))
+        {
+          server.SetAttribute ("PacketSize", UintegerValue (std::stoul (s.Get ("size"))));
+        }
+      if (s.Has ("on"))
+        {
+          server.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant="
+                                                      + s.Get ("on") + "]"));
+        }
+      if (s.Has ("off"))
+        {
+          server.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant="
+                                                       + s.Get ("off") + "]"));
+        }
+      if (s.Has ("rate"))
+        {
+          server.SetAttribute ("DataRate", DataRateValue (DataRate (s.Get ("rate"))));
+        }
+      ApplicationContainer serverApp = server.Install (src.Get (i));
+      serverApp.Start (Seconds (OptionSeconds (s, "start", 0)));
+      if (s.Has ("stop"))
+        {
+          serverApp.Stop (Seconds (OptionSeconds (s, "stop", 0)));
+        }
+      m_flows.push_back (flow);
+    }
+}
+
+void
+Scenario::CalculateGoodput (Time interval)
+{
+  Ptr<PacketSink> sink = m_flows.back ().sink;
+  Time now = Simulator::Now ();
+  double cur = (sink->GetTotalRx () - m_lastTotalRx) * (double) 8 / (1e6 * interval.GetSeconds ());
+  std::cout << now.GetSeconds () << "s: \t" << cur << " Mbit/s" << std::endl;
+  m_goodput << now.GetSeconds () << " " << cur << std::endl;
+  m_lastTotalRx = sink->GetTotalRx ();
+  Simulator::Schedule (interval, &Scenario::CalculateGoodput, this, interval);
+}
+
+void
+Scenario::DoGoodput (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_IF (m_flows.empty (), Where (s) << "comes after the flows");
+  m_goodput.open (Output (s.Get ("file", "goodput.txt")).c_str ());
+  Simulator::Schedule (Seconds (OptionSeconds (s, "start", 1.1)), &Scenario::CalculateGoodput,
+                       this, Seconds (OptionSeconds (s, "interval", 0.1)));
+}
+
+void
+Scenario::DoFlowGoodput (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_IF (m_flows.empty (), Where (s) << "comes after the flows");
+  NS_ABORT_MSG_IF (m_goodputMonitor, Where (s) << "flow goodput is already sampled");
+  m_goodputMonitor.reset (new GoodputMonitor);
+  for (size_t i = 0; i < m_flows.size (); i++)
+    {
+      m_goodputMonitor->Add (m_flows[i].sink,
+                             m_flows[i].variant.empty () ? "default" : m_flows[i].variant);
+    }
+  m_goodputFile = s.Get ("file", "goodput-flows.txt");
+  double start = OptionSeconds (s, "start", 1);
+  Simulator::Schedule (Seconds (start), &GoodputMonitor::Start, m_goodputMonitor.get (),
+                       Seconds (OptionSeconds (s, "interval", 0.1)), Seconds (m_stop - start));
+}
+
+void
+Scenario::DoQueue (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_UNLESS (s.args.size () == 1, Where (s) << "expected queue <segment>[i]");
+  std::vector<ScenarioRef> refs;
+  NS_ABORT_MSG_UNLESS (ParseScenarioRefs (s.args[0], refs) && refs.size () == 1,
+                       Where (s) << "bad queue " << s.args[0]);
+  Segment &segment = GetSegment (s, refs[0].group);
+  NS_ABORT_MSG_UNLESS (refs[0].first < segment.queueDiscs.GetN (),
+                       Where (s) << "no queue disc on " << s.args[0]);
+  m_queue = segment.queueDiscs.Get (refs[0].first);
+
+  double interval = OptionSeconds (s, "trace", 0);
+  bool events = s.Get ("events", "false") == "true";
+  if (interval > 0 || events)
+    {
+      std::string format = s.Get ("format", "text");
+      NS_ABORT_MSG_UNLESS (format == "text" || format == "binary",
+                           Where (s) << "format is text or binary");
+      std::unique_ptr<QueueMonitor> monitor (
+        new QueueMonitor (format == "binary" ? QueueMonitorBuffer::BINARY
+                                             : QueueMonitorBuffer::TEXT));
+      monitor->Add (m_queue, Output (s.Get ("file", "red-queue")));
+      if (events)
+        {
+          monitor->StartTracing ();
+        }
+      else
+        {
+          monitor->StartSampling (Seconds (interval));
+        }
+      m_queueMonitors.push_back (std::move (monitor));
+    }
+}
+
+void
+Scenario::DoFlowMonitor (const ScenarioStatement &s)
+{
+  NS_ABORT_MSG_IF (m_flowMonitor, Where (s) << "the flow monitor is already installed");
+  if (s.Get ("xml", "true") == "true")
+    {
+      m_flowMonitorFile = s.Get ("file", "flowmonitor.xml");
+    }
+  m_flowMonitor = m_flowHelper.InstallAll ();
+  m_flowMonitor->CheckForLostPackets ();
+  uint32_t fairness = std::stoul (s.Get ("fairness", "50"));
+  m_flowStats.reset (new FlowStatsCollector (m_flowMonitor, fairness));
+  double interval = OptionSeconds (s, "stats", 0);
+  if (interval > 0)
+    {
+      m_flowStats->StartSnapshots (Seconds (interval), Output ("flowstats.csv"));
+    }
+}
+
+void
+Scenario::DoSummary (const ScenarioStatement &s)
+{
+  if (s.Has ("capacity"))
+    {
+      m_capacity = DataRate (s.Get ("capacity")).GetBitRate ();
+    }
+  m_unit = s.Get ("unit", m_unit);
+  NS_ABORT_MSG_UNLESS (m_unit == "Mbit/s" || m_unit == "Kbit/s",
+                       Where (s) << "unknown unit " << m_unit);
+}
+
+double
+Scenario::JainIndex (const std::string &variant) const
+{
+  double sum = 0;
+  double sumSquares = 0;
+  uint32_t n = 0;
+  for (size_t i = 0; i < m_flows.size (); i++)
+    {
+      if (!variant.empty () && m_flows[i].variant != variant)
+        {
+          continue;
+        }
+      double rx = m_flows[i].sink->GetTotalRx ();
+      sum += rx;
+      sumSquares += rx * rx;
+      n++;
+    }
+  return sumSquares > 0 ? sum * sum / (n * sumSquares) : 0;
+}
+
+void
+Scenario::Report (int64_t wallClockMs) const
+{
+  std::ofstream file (Output ("summary.txt").c_str ());
+  std::stringstream out;
+  double scale = m_unit == "Mbit/s" ? 1e6 : 1e3;
+
+  for (std::map<std::string, std::string>::const_iterator it = m_params.begin ();
+       it != m_params.end (); ++it)
+    {
+      file << "# " << it->first << "=" << it->second << std::endl;
+    }
+
+  if (!m_flows.empty ())
+    {
+      uint64_t lastRx = m_flows.back ().sink->GetTotalRx ();
+      double averageGoodput = (lastRx * 8) / (1e6 * m_time);
+      out << "Average Goodput: " << averageGoodput << "Mbit/s" << std::endl;
+      out << "Average Goodput(Packets): " << (averageGoodput * 1e6 / 1000) << std::endl;
+
+      uint64_t totalRx = 0;
+      std::set<std::string> variants;
+      for (size_t i = 0; i < m_flows.size (); i++)
+        {
+          totalRx += m_flows[i].sink->GetTotalRx ();
+          if (!m_flows[i].variant.empty ())
+            {
+              variants.insert (m_flows[i].variant);
+            }
+        }
+      out << "Aggregate Goodput: " << totalRx * 8 / (scale * m_time) << m_unit << std::endl;
+      if (m_capacity > 0)
+        {
+          out << "Bottleneck utilization: " << totalRx * 8 / (m_capacity * m_time) * 100 << " %"
+              << std::endl;
+        }
+      out << "Jain's index: all flows " << JainIndex ("");
+      for (std::set<std::string>::const_iterator it = variants.begin ();
+           it != variants.end (); ++it)
+        {
+          out << ", " << *it << " " << JainIndex (*it);
+        }
+      out << std::endl;
+    }
+  if (m_goodputMonitor)
+    {
+      const GoodputMatrix &matrix = m_goodputMonitor->GetMatrix ();
+      std::set<std::string> variants;
+      for (uint32_t i = 0; i < matrix.GetFlows (); i++)
+        {
+          variants.insert (matrix.GetVariant (i));
+        }
+      variants.insert ("");
+      for (std::set<std::string>::const_iterator it = variants.begin ();
+           it != variants.end (); ++it)
+        {
+          GoodputStats stats = matrix.GetStats (*it);
+          out << "Goodput " << (it->empty () ? "all flows" : *it) << ": aggregate "
+              << stats.aggregate / scale << m_unit << ", per flow min " << stats.min / scale
+              << " median " << stats.median / scale << " max " << stats.max / scale << m_unit
+              << std::endl;
+        }
+    }
+  if (m_queue)
+    {
+      out << "Bottleneck drops: " << m_queue->GetStats ().nTotalDroppedPackets << std::endl;
+      out << "Bottleneck ECN marks: " << m_queue->GetStats ().nTotalMarkedPackets << std::endl;
+    }
+  if (m_flowMonitor)
+    {
+      uint32_t lostPackets = 0;
+      for (auto const &flowStats : m_flowMonitor->GetFlowStats ())
+        {
+          lostPackets += flowStats.second.lostPackets;
+        }
+      out << "Lost packets (retransmitted): " << lostPackets << std::endl;
+    }
+  out << "Simulation wall-clock: " << wallClockMs << " ms" << std::endl;
+
+  std::cout << out.str ();
+  file << out.str ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string configPath;
+  std::string runDir = ".";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("config", "Scenario file", configPath);
+  cmd.AddValue ("runDir", "Directory for every output of the run", runDir);
+  cmd.AddValue ("param", "Override a scenario parameter, name=value; may be repeated",
+                MakeCallback (&AddParam));
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (configPath.empty (), "--config=<scenario file> is required");
+
+  ScenarioConfig config;
+  std::string error;
+  NS_ABORT_MSG_UNLESS (config.Load (configPath, paramOverrides, error), error);
+  SystemPath::MakeDirectories (runDir);
+
+  Scenario scenario (configPath, runDir, argc, argv);
+  scenario.Run (config);
+  return 0;
+}
@@ -0,0 +1,266 @@
+#!/usr/bin/env python3
+# Parameter sweep over a scenario file, on every core.
+#
+# Expands a grid of scenario parameters (--grid name values...) and ns-3
+# attributes (--grid ns3::Type::Attribute values...) times --seeds RngRun
+# values, and runs each combination as its own scenario process. Workers
+# take the next job as soon as they are free, so long and short runs mix
+# without idle cores. Every finished job is appended to ledger.jsonl in the
+# sweep directory; running the same command again skips those jobs, so an
+# interrupted sweep resumes where it stopped. Job ids hash the contents of
+# the scenario file and the size and mtime of the program, so after an
+# edit or a rebuild every job runs again instead of reusing stale results.
+#
+# Results are the mean and 95% confidence interval over the seeds of each
+# grid point: aggregate goodput and Jain's index from summary.txt, mean
+# delay and loss ratio from flowstats.json (flowmonitor.xml for older
+# runs). They go to results.tsv and stdout.
+#
+#   ./waf build
+#   python3 scratch/scenario/sweep.py --config scratch/scenario/configs/wired-b.scn \
+#       --grid flow 2 10 50 --grid bottleneckRate 10Mbps 100Mbps \
+#       --grid variants ns3::TcpBic,ns3::TcpLibra ns3::TcpLibra \
+#       --seeds 10 --out sweeps/wired-b
+#
+# Run from the ns-3 tree, or point --ns3 at it.
+
+import argparse
+import hashlib
+import itertools
+import json
+import math
+import os
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+from xml.etree import ElementTree as ET
+
+# Two-sided 95% Student t quantiles by degrees of freedom, 1.96 beyond
+T95 = [0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+METRICS = ["goodput", "delay", "loss", "jain"]
+UNITS = {"goodput": "Mbit/s", "delay": "ms", "loss": "ratio", "jain": "index"}
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Run a scenario over a parameter grid and seeds")
+    parser.add_argument("--config", required=True, help="scenario file")
+    parser.add_argument("--grid", nargs="+", action="append", default=[], metavar="NAME VALUE",
+                        help="parameter or ns3:: attribute and its values; may be repeated")
+    parser.add_argument("--seeds", type=int, default=1, help="RngRun values 1..N per grid point")
+    parser.add_argument("--out", required=True, help="sweep directory: ledger, runs, results")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="parallel runs")
+    parser.add_argument("--ns3", default=".", help="ns-3 tree with the scenario program built")
+    parser.add_argument("--program", default="build/scratch/scenario/scenario",
+                        help="scenario binary, relative to --ns3")
+    parser.add_argument("--dry-run", action="store_true", help="list the jobs to run and stop")
+    parser.add_argument("--aggregate-only", action="store_true",
+                        help="rebuild results.tsv from the ledger without running")
+    args = parser.parse_args()
+    for grid in args.grid:
+        if len(grid) < 2:
+            parser.error("--grid needs a name and at least one value")
+    return args
+
+
+def build_stamp(args):
+    """What the results depend on besides the grid point: config contents and program build."""
+    with open(args.config, "rb") as config:
+        stamp = [hashlib.sha1(config.read()).hexdigest()]
+    try:
+        program = os.stat(os.path.join(args.ns3, args.program))
+        stamp += [program.st_size, program.st_mtime_ns]
+    except OSError:
+        stamp.append(None)  # not built; the run itself refuses to start
+    return stamp
+
+
+def expand(args):
+    """The jobs of the sweep: one per grid point and seed, with a stable id."""
+    names = [grid[0] for grid in args.grid]
+    stamp = build_stamp(args)
+    jobs = []
+    # Seed-major order, so an interrupted sweep has every point at low seed counts
+    for seed in range(1, args.seeds + 1):
+        for values in itertools.product(*[grid[1:] for grid in args.grid]):
+            point = dict(zip(names, values))
+            key = json.dumps([os.path.abspath(args.config), stamp, point, seed], sort_keys=True)
+            jobs.append({"id": hashlib.sha1(key.encode()).hexdigest()[:12],
+                         "point": point, "seed": seed})
+    return jobs
+
+
+def command(args, job, run_dir):
+    cmd = [os.path.join(args.ns3, args.program),
+           "--config=" + os.path.abspath(args.config),
+           "--runDir=" + run_dir,
+           "--RngRun=%d" % job["seed"]]
+    for name, value in sorted(job["point"].items()):
+        if name.startswith("ns3::"):
+            cmd.append("--%s=%s" % (name, value))
+        else:
+            cmd.append("--param=%s=%s" % (name, value))
+    return cmd
+
+
+def read_ledger(path):
+    done = {}
+    if os.path.exists(path):
+        with open(path) as ledger:
+            for line in ledger:
+                try:
+                    entry = json.loads(line)
+                except ValueError:
+                    continue  # a line cut short by a crash
+                if entry.get("status") == "done":
+                    done[entry["id"]] = entry
+    return done
+
+
+def read_metrics(run_dir):
+    """Goodput and Jain's index from summary.txt, delay and loss from the flow statistics."""
+    metrics = {}
+    summary = os.path.join(run_dir, "summary.txt")
+    if os.path.exists(summary):
+        with open(summary) as f:
+            for line in f:
+                if line.startswith("Aggregate Goodput: "):
+                    value = line.split(":", 1)[1].strip()
+                    scale = 1e-3 if value.endswith("Kbit/s") else 1.0
+                    metrics["goodput"] = float(value.rstrip("Mbit/sK")) * scale
+                elif line.startswith("Jain's index: all flows "):
+                    metrics["jain"] = float(line.split()[4].rstrip(","))
+    flowstats = os.path.join(run_dir, "flowstats.json")
+    flowmon = os.path.join(run_dir, "flowmonitor.xml")
+    if os.path.exists(flowstats):
+        with open(flowstats) as f:
+            stats = json.load(f)
+        if stats.get("meanDelayMs") is not None:
+            metrics["delay"] = stats["meanDelayMs"]
+        if stats.get("dropRatio") is not None:
+            metrics["loss"] = stats["dropRatio"]
+    elif os.path.exists(flowmon):
+        rx_packets = tx_packets = lost = 0
+        delay = 0.0
+        for flow in ET.parse(flowmon).findall("FlowStats/Flow"):
+            rx_packets += int(flow.get("rxPackets"))
+            tx_packets += int(flow.get("txPackets"))
+            lost += int(flow.get("lostPackets"))
+            delay += float(flow.get("delaySum")[:-2])
+        if rx_packets > 0:
+            metrics["delay"] = delay * 1e-6 / rx_packets
+        if tx_packets > 0:
+            metrics["loss"] = lost * 1.0 / tx_packets
+    return metrics
+
+
+def run_job(args, job):
+    run_dir = os.path.join(os.path.abspath(args.out), "runs", job["id"])
+    os.makedirs(run_dir, exist_ok=True)
+    env = dict(os.environ)
+    lib = os.path.join(os.path.abspath(args.ns3), "build", "lib")
+    env["LD_LIBRARY_PATH"] = lib + os.pathsep + env.get("LD_LIBRARY_PATH", "")
+    start = time.time()
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as out:
+        returncode = subprocess.call(command(args, job, run_dir), stdout=out,
+                                     stderr=subprocess.STDOUT, env=env)
+    entry = dict(job)
+    entry["seconds"] = round(time.time() - start, 3)
+    entry["returncode"] = returncode
+    entry["status"] = "done" if returncode == 0 else "failed"
+    if returncode == 0:
+        entry["metrics"] = read_metrics(run_dir)
+    return entry
+
+
+def confidence(values):
+    """Mean and 95% confidence half-width."""
+    n = len(values)
+    mean = sum(values) / n
+    if n < 2:
+        return mean, float("nan")
+    variance = sum((v - mean) ** 2 for v in values) / (n - 1)
+    t = T95[n - 1] if n - 1 < len(T95) else 1.96
+    return mean, t * math.sqrt(variance / n)
+
+
+def aggregate(args, jobs, done):
+    names = [grid[0] for grid in args.grid]
+    points = {}
+    for job in jobs:
+        entry = done.get(job["id"])
+        if entry is None:
+            continue
+        key = tuple(job["point"][name] for name in names)
+        points.setdefault(key, []).append(entry.get("metrics", {}))
+
+    header = names + ["runs"]
+    for metric in METRICS:
+        header += ["%s(%s)" % (metric, UNITS[metric]), "ci95"]
+    lines = ["\t".join(header)]
+    for key in sorted(points):
+        row = list(key) + [str(len(points[key]))]
+        for metric in METRICS:
+            values = [m[metric] for m in points[key] if metric in m]
+            if values:
+                mean, half = confidence(values)
+                row += ["%.6g" % mean, "%.3g" % half]
+            else:
+                row += ["-", "-"]
+        lines.append("\t".join(row))
+
+    with open(os.path.join(args.out, "results.tsv"), "w") as results:
+        results.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+
+def main():
+    args = parse_args()
+    os.makedirs(args.out, exist_ok=True)
+    ledger_path = os.path.join(args.out, "ledger.jsonl")
+    jobs = expand(args)
+    done = read_ledger(ledger_path)
+    pending = [job for job in jobs if job["id"] not in done]
+    stale = len(set(done) - set(job["id"] for job in jobs))
+    if stale:
+        print("%d ledger results are from another config, build or grid; ignored" % stale,
+              file=sys.stderr)
+
+    if args.dry_run:
+        for job in pending:
+            print(job["id"], " ".join(command(args, job, os.path.join(args.out, "runs", job["id"]))))
+        print("%d jobs, %d done, %d to run" % (len(jobs), len(jobs) - len(pending), len(pending)))
+        return 0
+
+    failed = 0
+    if not args.aggregate_only and pending:
+        program = os.path.join(args.ns3, args.program)
+        if not os.access(program, os.X_OK):
+            sys.exit("%s not found; build the scenario program or set --ns3/--program" % program)
+        print("%d jobs, %d done, running %d on %d workers"
+              % (len(jobs), len(jobs) - len(pending), len(pending), args.jobs), file=sys.stderr)
+        with open(ledger_path, "a") as ledger, ThreadPoolExecutor(max_workers=args.jobs) as pool:
+            futures = [pool.submit(run_job, args, job) for job in pending]
+            for count, future in enumerate(as_completed(futures), 1):
+                entry = future.result()
+                ledger.write(json.dumps(entry, sort_keys=True) + "\n")
+                ledger.flush()
+                os.fsync(ledger.fileno())
+                if entry["status"] == "done":
+                    done[entry["id"]] = entry
+                else:
+                    failed += 1
+                    print("job %s failed (%d), see runs/%s/stdout.txt"
+                          % (entry["id"], entry["returncode"], entry["id"]), file=sys.stderr)
+                print("[%d/%d] %s %.1fs" % (count, len(pending), entry["id"], entry["seconds"]),
+                      file=sys.stderr)
+
+    aggregate(args, jobs, done)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,1070 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef TCPLIBRA_CORE_H
+#define TCPLIBRA_CORE_H
+
+#include "tcp-libra-exp-table.h"
+#include "tcp-libra-fixed-point.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Conversions the Libra core needs from its time type
+ *
+ * Specialize for other types; the ns-3 adapter does so for ns3::Time. A
+ * specialization provides Zero, Max and Min values, the conversions to
+ * seconds and microseconds, and a Sum type wide enough to add up the RTT
+ * samples of a round. The time type itself must support +, -, and
+ * comparisons, and Sum division by an integer count.
+ */
+template <typename TimeT>
+struct TcpLibraTimeTraits;
+
+/// Time in seconds, as a double
+template <>
+struct TcpLibraTimeTraits<double>
+{
+  typedef double Sum;
+  static double Zero () { return 0.0; }
+  static double Max () { return std::numeric_limits<double>::max (); }
+  static double Min () { return -std::numeric_limits<double>::max (); }
+  static double Seconds (double t) { return t; }
+  static int64_t MicroSeconds (double t) { return static_cast<int64_t> (t * 1e6); }
+};
+
+/// Time in integer microseconds
+template <>
+struct TcpLibraTimeTraits<int64_t>
+{
+  typedef int64_t Sum;
+  static int64_t Zero () { return 0; }
+  static int64_t Max () { return std::numeric_limits<int64_t>::max (); }
+  static int64_t Min () { return std::numeric_limits<int64_t>::min (); }
+  static double Seconds (int64_t t) { return t * 1e-6; }
+  static int64_t MicroSeconds (int64_t t) { return t; }
+};
+
+/**
+ * Time in 32-bit unsigned microseconds, for compact per-flow state
+ *
+ * RTTs up to 71 minutes fit. Timestamps wrap every 71 minutes; the core
+ * only uses their differences, which stay correct across a wrap.
+ */
+template <>
+struct TcpLibraTimeTraits<uint32_t>
+{
+  typedef uint64_t Sum;
+  static uint32_t Zero () { return 0; }
+  static uint32_t Max () { return std::numeric_limits<uint32_t>::max (); }
+  static uint32_t Min () { return 0; }
+  static double Seconds (uint32_t t) { return t * 1e-6; }
+  static int64_t MicroSeconds (uint32_t t) { return t; }
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Conversions the Libra core needs from its rate type
+ *
+ * A specialization converts to and from bytes per second. The rate type
+ * must support operator< and operator>=.
+ */
+template <typename RateT>
+struct TcpLibraRateTraits;
+
+/// Rate in bytes per second, as a double
+template <>
+struct TcpLibraRateTraits<double>
+{
+  static double BytesPerSecond (double r) { return r; }
+  static double FromBytesPerSecond (double r) { return r; }
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Windowed min or max filter with three samples
+ *
+ * Kathleen Nichols' algorithm, as in ns-3's WindowedFilter and Linux
+ * win_minmax, kept here so the core has no dependencies. Compare (a, b)
+ * is true when a should replace b as the best sample.
+ */
+template <typename T, typename Compare, typename TimeT>
+class TcpLibraWindowedFilter
+{
+public:
+  /**
+   * \param windowLength the filter window, in units of TimeT
+   * \param zeroValue the sample value meaning "no sample"
+   * \param zeroTime the initial time
+   */
+  TcpLibraWindowedFilter (TimeT windowLength, T zeroValue, TimeT zeroTime)
+    : m_windowLength (windowLength),
+      m_zeroValue (zeroValue)
+  {
+    m_estimates[0] = m_estimates[1] = m_estimates[2] = Sample (zeroValue, zeroTime);
+  }
+
+  /**
+   * \brief Change the window length
+   * \param windowLength the filter window, in units of TimeT
+   */
+  void SetWindowLength (TimeT windowLength)
+  {
+    m_windowLength = windowLength;
+  }
+
+  /**
+   * \brief Feed a new sample
+   * \param newSample the sample
+   * \param newTime the time of the sample
+   */
+  void Update (T newSample, TimeT newTime)
+  {
+    // Reset on the first sample, a new best, or a window without samples.
+    if (m_estimates[0].sample == m_zeroValue
+        || Compare () (newSample, m_estimates[0].sample)
+        || newTime - m_estimates[2].time > m_windowLength)
+      {
+        Reset (newSample, newTime);
+        return;
+      }
+
+    if (Compare () (newSample, m_estimates[1].sample))
+      {
+        m_estimates[1] = Sample (newSample, newTime);
+        m_estimates[2] = m_estimates[1];
+      }
+    else if (Compare () (newSample, m_estimates[2].sample))
+      {
+        m_estimates[2] = Sample (newSample, newTime);
+      }
+
+    // Expire the best sample and shift the others down.
+    if (newTime - m_estimates[0].time > m_windowLength)
+      {
+        m_estimates[0] = m_estimates[1];
+        m_estimates[1] = m_estimates[2];
+        m_estimates[2] = Sample (newSample, newTime);
+        if (newTime - m_estimates[0].time > m_windowLength)
+          {
+            m_estimates[0] = m_estimates[1];
+            m_estimates[1] = m_estimates[2];
+          }
+        return;
+      }
+
+    // Keep the second and third samples from different quarters and
+    // halves of the window.
+    if (m_estimates[1].sample == m_estimates[0].sample
+        && newTime - m_estimates[1].time > m_windowLength / 4)
+      {
+        m_estimates[2] = m_estimates[1] = Sample (newSample, newTime);
+        return;
+      }
+    if (m_estimates[2].sample == m_estimates[1].sample
+        && newTime - m_estimates[2].time > m_windowLength / 2)
+      {
+        m_estimates[2] = Sample (newSample, newTime);
+      }
+  }
+
+  /**
+   * \brief Forget all samples but this one
+   * \param newSample the sample
+   * \param newTime the time of the sample
+   */
+  void Reset (T newSample, TimeT newTime)
+  {
+    m_estimates[0] = m_estimates[1] = m_estimates[2] = Sample (newSample, newTime);
+  }
+
+  /// \return the best sample in the window
+  T GetBest () const
+  {
+    return m_estimates[0].sample;
+  }
+
+private:
+  struct Sample
+  {
+    T sample;
+    TimeT time;
+    Sample () : sample (), time () {}
+    Sample (T s, TimeT t) : sample (s), time (t) {}
+  };
+
+  TimeT m_windowLength;  //!< Window length
+  T m_zeroValue;         //!< Sample value meaning "no sample"
+  Sample m_estimates[3]; //!< Best, second best and third best samples
+};
+
+/// Compare for a windowed minimum
+template <typename T>
+struct TcpLibraMinCompare
+{
+  bool operator() (const T &a, const T &b) const { return a <= b; }
+};
+
+/// Compare for a windowed maximum
+template <typename T>
+struct TcpLibraMaxCompare
+{
+  bool operator() (const T &a, const T &b) const { return a >= b; }
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief The Libra control law, free of ns-3
+ *
+ * Holds the RTT statistics of TcpLibra (base, maximum, per-round sum and
+ * count, average of the last round and last sample), the packet-pair
+ * capacity estimate over probes of back-to-back sends, alpha = P * S and
+ * the window accumulator, and turns them into congestion-avoidance
+ * increases and loss decreases:
+ *
+ *   increase per ACK  alpha * RTT^2 / ((T0 + RTT) * cwnd)
+ *   decrease per loss T1 * cwnd / (2 * (T0 + RTT))
+ *
+ * with P = exp (-k2 * Qavg / Qmax) and S = k1 * capacity; k1, k2, T0 and T1
+ * default to 2, 2, 1s and 1s. The caller feeds ACK arrivals, round
+ * boundaries and RTT samples in that order, then asks for the window
+ * change; for the capacity estimate it also reports new data sent. Slow
+ * start, HyStart, pacing and ECN stay with the transport that embeds the
+ * core.
+ *
+ * TimeT and RateT are the time and rate types of the embedding code; see
+ * TcpLibraTimeTraits and TcpLibraRateTraits.
+ */
+template <typename TimeT, typename RateT>
+class TcpLibraCore
+{
+public:
+  typedef TcpLibraTimeTraits<TimeT> TimeTraits; //!< Time conversions
+  typedef TcpLibraRateTraits<RateT> RateTraits; //!< Rate conversions
+
+  TcpLibraCore ()
+    : m_cWndCnt (0),
+      m_caGain (0.0),
+      m_caGainQ16 (0),
+      m_alpha (10.0),
+      m_penalty (1.0),
+      m_sumRtt (TimeTraits::Zero ()),
+      m_lastRtt (TimeTraits::Zero ()),
+      m_avgRtt (TimeTraits::Zero ()),
+      m_probeAckTime (TimeTraits::Zero ()),
+      m_burstLastAck (TimeTraits::Zero ()),
+      m_burstRtt (TimeTraits::Zero ()),
+      m_cntRtt (0),
+      m_roundCount (0),
+      m_roundEnd (0),
+      m_lawUpdates (0),
+      m_burstStart (0),
+      m_burstEnd (0),
+      m_burstSends (0),
+      m_probeStart (0),
+      m_probeEnd (0),
+      m_probeAck (0),
+      m_burstTime (TimeTraits::Zero ()),
+      m_alphaStale (true),
+      m_fixedPoint (false),
+      m_tableExp (false),
+      m_baseRttFilter (100, TimeTraits::Max (), 0),
+      m_maxRttFilter (4, TimeTraits::Min (), 0),
+      m_capacity (RateTraits::FromBytesPerSecond (0.0)),
+      m_groupCapacity (RateTraits::FromBytesPerSecond (0.0)),
+      m_initialCapacity (RateTraits::FromBytesPerSecond (100e6 / 8)),
+      m_deliveryRateFilter (10, RateTraits::FromBytesPerSecond (0.0), 0),
+      m_capacityHead (0),
+      m_compressedAcks (0),
+      m_baseRttWindow (100),
+      m_maxRttWindow (4),
+      m_capacityWindow (15),
+      m_deliveryRateWindow (10),
+      m_k1 (2.0),
+      m_k2 (2.0),
+      m_t0 (1.0),
+      m_t1 (1.0)
+  {
+  }
+
+  /// \param rounds length of the minimum RTT window (rounds)
+  void SetBaseRttWindow (uint32_t rounds) { m_baseRttWindow = rounds; }
+  /// \param rounds length of the maximum RTT window (rounds)
+  void SetMaxRttWindow (uint32_t rounds) { m_maxRttWindow = rounds; }
+  /// \param rate capacity assumed until the first estimate
+  void SetInitialCapacity (RateT rate) { m_initialCapacity = rate; }
+  /// \param samples number of packet-pair samples to filter
+  void SetCapacityWindow (uint32_t samples) { m_capacityWindow = samples; }
+  /// \param rounds length of the delivery rate maximum window (rounds)
+  void SetDeliveryRateWindow (uint32_t rounds) { m_deliveryRateWindow = rounds; }
+  /// \param enable run the window updates in Q16.16 arithmetic
+  void SetFixedPoint (bool enable) { m_fixedPoint = enable; }
+  /// \param enable evaluate the penalty with TcpLibraExpTable
+  void SetTableExp (bool enable) { m_tableExp = enable; }
+  /// \param k1 scalability factor gain
+  void SetK1 (double k1) { m_k1 = k1; m_alphaStale = true; }
+  /// \param k2 penalty factor exponent gain
+  void SetK2 (double k2) { m_k2 = k2; m_alphaStale = true; }
+  /// \param t0 the T0 parameter (s)
+  void SetT0 (double t0) { m_t0 = t0; m_alphaStale = true; }
+  /// \param t1 the T1 parameter (s)
+  void SetT1 (double t1) { m_t1 = t1; m_alphaStale = true; }
+
+  /// \return length of the minimum RTT window (rounds)
+  uint32_t GetBaseRttWindow () const { return m_baseRttWindow; }
+  /// \return length of the maximum RTT window (rounds)
+  uint32_t GetMaxRttWindow () const { return m_maxRttWindow; }
+  /// \return capacity assumed until the first estimate
+  RateT GetInitialCapacity () const { return m_initialCapacity; }
+  /// \return number of packet-pair samples to filter
+  uint32_t GetCapacityWindow () const { return m_capacityWindow; }
+  /// \return length of the delivery rate maximum window (rounds)
+  uint32_t GetDeliveryRateWindow () const { return m_deliveryRateWindow; }
+  /// \return true if the window updates run in Q16.16 arithmetic
+  bool GetFixedPoint () const { return m_fixedPoint; }
+  /// \return true if the penalty is evaluated with TcpLibraExpTable
+  bool GetTableExp () const { return m_tableExp; }
+  /// \return scalability factor gain
+  double GetK1 () const { return m_k1; }
+  /// \return penalty factor exponent gain
+  double GetK2 () const { return m_k2; }
+  /// \return the T0 parameter (s)
+  double GetT0 () const { return m_t0; }
+  /// \return the T1 parameter (s)
+  double GetT1 () const { return m_t1; }
+
+  /// \return minimum RTT over the base RTT window, Max if no sample yet
+  TimeT GetBaseRtt () const { return m_baseRttFilter.GetBest (); }
+  /// \return maximum RTT over the max RTT window, Min if no sample yet
+  TimeT GetMaxRtt () const { return m_maxRttFilter.GetBest (); }
+  /// \return average RTT of the last complete round
+  TimeT GetAvgRtt () const { return m_avgRtt; }
+  /// \return last RTT sample
+  TimeT GetLastRtt () const { return m_lastRtt; }
+  /// \return sum of the RTT samples of the current round
+  typename TimeTraits::Sum GetSumRtt () const { return m_sumRtt; }
+  /// \return number of RTT samples of the current round
+  uint32_t GetCntRtt () const { return m_cntRtt; }
+  /// \return alpha as of the last control law update
+  double GetAlpha () const { return m_alpha; }
+  /// \return penalty factor P as of the last control law update
+  double GetPenalty () const { return m_penalty; }
+  /// \return number of control law updates so far, to detect a new one
+  uint32_t GetLawUpdates () const { return m_lawUpdates; }
+  /**
+   * \param cWnd the congestion window (bytes)
+   * \return the congestion avoidance increase for one ACK at cWnd (bytes)
+   */
+  double GetAdder (uint32_t cWnd) const
+  {
+    if (m_fixedPoint)
+      {
+        return static_cast<double> (TcpLibraFixedPoint::Increase (m_caGainQ16, cWnd))
+               / TcpLibraFixedPoint::One;
+      }
+    return m_caGain / cWnd;
+  }
+  /// \return estimated narrow link capacity, zero if unknown
+  RateT GetCapacity () const { return m_capacity; }
+  /// \return number of RTT rounds elapsed
+  uint32_t GetRoundCount () const { return m_roundCount; }
+  /// \return end sequence of the current round
+  uint32_t GetRoundEnd () const { return m_roundEnd; }
+
+  /**
+   * \brief Note new data handed to the network, for the packet-pair probes
+   *
+   * Segments sent at the same instant leave the sender back to back. The
+   * current run of such segments is kept; when it ends, a run of two
+   * segments or more becomes the probe, unless one is still in flight.
+   *
+   * \param now the send time
+   * \param seq first sequence of the data
+   * \param endSeq sequence just after the data
+   */
+  void OnSend (TimeT now, uint32_t seq, uint32_t endSeq)
+  {
+    if (m_burstSends > 0 && now == m_burstTime && seq == m_burstEnd)
+      {
+        m_burstEnd = endSeq;
+        ++m_burstSends;
+        return;
+      }
+    CloseBurst ();
+    m_burstStart = seq;
+    m_burstEnd = endSeq;
+    m_burstTime = now;
+    m_burstSends = 1;
+  }
+
+  /**
+   * \brief Feed an ACK into the capacity estimate
+   *
+   * Segments of a probe left the sender back to back, so each queued
+   * behind the previous one at the narrow link and left it spaced by its
+   * serialization time, a spacing their ACKs keep. A sample is the data
+   * acked over the time since the previous ACK, taken only when both ACKs
+   * end inside the same probe; the estimate is the median of the last
+   * capacity window samples. ACKs spaced by the sender's own gaps, such as
+   * two ACK-clocked segments or a probe and the data after it, give none.
+   *
+   * \param now arrival time of the ACK
+   * \param ackSeq the cumulative ACK sequence
+   * \return true if the ACK gave a sample
+   */
+  bool UpdateCapacityEstimate (TimeT now, uint32_t ackSeq)
+  {
+    if (m_burstSends > 0 && now != m_burstTime)
+      {
+        CloseBurst ();
+      }
+    // No probe, or an ACK that does not advance into it
+    if (m_probeEnd == m_probeStart || !SeqLess (m_probeAck, ackSeq))
+      {
+        return false;
+      }
+
+    bool anchored = m_probeAck != m_probeStart;
+    bool inside = !SeqLess (m_probeEnd, ackSeq);
+    TimeT spacing = now - m_probeAckTime;
+    uint32_t bytes = ackSeq - m_probeAck;
+    if (SeqLess (ackSeq, m_probeEnd))
+      {
+        m_probeAck = ackSeq;
+        m_probeAckTime = now;
+      }
+    else
+      {
+        ResetCapacityProbe ();
+      }
+
+    // The first ACK into the probe only anchors the next. A gap longer than
+    // the base RTT comes from a stall rather than serialization.
+    if (!anchored || !inside || !(spacing > TimeTraits::Zero ())
+        || spacing > GetBaseRtt ())
+      {
+        return false;
+      }
+
+    RateT sample = RateTraits::FromBytesPerSecond (bytes / TimeTraits::Seconds (spacing));
+    // m_capacitySamples is a ring in arrival order, oldest at m_capacityHead
+    // once full. It is only allocated once samples arrive, so a flow fed by
+    // UpdateDeliveryRate never pays for it.
+    if (m_capacitySamples.empty ())
+      {
+        m_capacitySamples.reserve (m_capacityWindow);
+        m_capacitySorted.reserve (m_capacityWindow);
+      }
+    if (m_capacitySamples.size () > m_capacityWindow)
+      {
+        // The window shrank: back to arrival order, then drop the oldest.
+        std::rotate (m_capacitySamples.begin (), m_capacitySamples.begin () + m_capacityHead,
+                     m_capacitySamples.end ());
+        m_capacityHead = 0;
+        while (m_capacitySamples.size () > m_capacityWindow)
+          {
+            EraseSorted (m_capacitySamples.front ());
+            m_capacitySamples.erase (m_capacitySamples.begin ());
+          }
+      }
+    if (m_capacitySamples.size () < m_capacityWindow)
+      {
+        m_capacitySamples.push_back (sample);
+      }
+    else
+      {
+        EraseSorted (m_capacitySamples[m_capacityHead]);
+        m_capacitySamples[m_capacityHead] = sample;
+        m_capacityHead = (m_capacityHead + 1) % m_capacityWindow;
+      }
+    m_capacitySorted.insert (std::upper_bound (m_capacitySorted.begin (),
+                                               m_capacitySorted.end (), sample),
+                             sample);
+
+    // Cross traffic slipping between the probe segments widens pairs and ACK
+    // compression narrows them; the median discards both tails. The window
+    // is kept sorted alongside the arrival order, so the median is a lookup
+    // rather than a selection per ACK.
+    m_capacity = m_capacitySorted[m_capacitySorted.size () / 2];
+    return true;
+  }
+
+  /**
+   * \brief Drop the probe in flight
+   *
+   * Call when the ACK stream stops reflecting the probe's spacing, as on a
+   * loss: retransmissions and the ACKs that fill a hole arrive on their own
+   * schedule.
+   */
+  void ResetCapacityProbe ()
+  {
+    m_probeEnd = m_probeStart;
+  }
+
+  /**
+   * \brief Feed a delivery rate sample into the capacity estimate
+   *
+   * An alternative to UpdateCapacityEstimate for senders that measure the
+   * delivery rate over whole flights, as in BBR: the capacity is the
+   * maximum sample over the delivery rate window. A sample taken while the
+   * application left the window unused only shows what the sender
+   * offered, so it counts only when it beats the current estimate.
+   *
+   * \param rate the delivery rate of the sample
+   * \param appLimited true if the sample was application limited
+   * \return true if the sample was used
+   */
+  bool UpdateDeliveryRate (RateT rate, bool appLimited)
+  {
+    if (!(RateTraits::BytesPerSecond (rate) > 0.0) || (appLimited && !(m_capacity < rate)))
+      {
+        return false;
+      }
+
+    m_deliveryRateFilter.Update (rate, m_roundCount);
+    m_capacity = m_deliveryRateFilter.GetBest ();
+    return true;
+  }
+
+  /**
+   * \brief Start from the path state learned by an earlier connection
+   *
+   * The base RTT and capacity stand in for the first samples, so the delay
+   * terms and the scalability factor are meaningful from the first round;
+   * lower RTTs and new capacity samples replace them as usual.
+   *
+   * \param baseRtt the minimum RTT seen on the path
+   * \param capacity the capacity estimate of the path
+   * \param alpha the last alpha, reported until the first law update
+   */
+  void WarmStart (TimeT baseRtt, RateT capacity, double alpha)
+  {
+    m_baseRttFilter.Reset (baseRtt, m_roundCount);
+    m_deliveryRateFilter.Reset (capacity, m_roundCount);
+    m_capacity = capacity;
+    m_alpha = alpha;
+    m_alphaStale = true;
+  }
+
+  /**
+   * \brief Start a new RTT round once the ACK covers the round's last segment
+   *
+   * The per-round RTT sum and count are rolled over into the average, so
+   * the average delay always describes the last complete round.
+   *
+   * \param ackedSeq highest sequence acknowledged
+   * \param highTxMark highest sequence sent, the end of the next round
+   * \return true if a new round started
+   */
+  bool UpdateRound (uint32_t ackedSeq, uint32_t highTxMark)
+  {
+    if (static_cast<int32_t> (ackedSeq - m_roundEnd) < 0)
+      {
+        return false;
+      }
+
+    m_roundEnd = highTxMark;
+    ++m_roundCount;
+
+    if (m_cntRtt > 0)
+      {
+        m_avgRtt = static_cast<TimeT> (m_sumRtt / m_cntRtt);
+      }
+    m_sumRtt = TimeTraits::Zero ();
+    m_cntRtt = 0;
+    m_alphaStale = true;
+
+    // Window lengths may change between rounds, so pick them up here.
+    m_baseRttFilter.SetWindowLength (m_baseRttWindow);
+    m_maxRttFilter.SetWindowLength (m_maxRttWindow);
+    m_deliveryRateFilter.SetWindowLength (m_deliveryRateWindow);
+    return true;
+  }
+
+  /**
+   * \brief Add an RTT sample to the statistics
+   * \param rtt the sample, non-zero
+   */
+  void UpdateRtt (TimeT rtt)
+  {
+    // A new minimum shifts every delay term, so don't wait for the round to
+    // end before recomputing alpha.
+    if (rtt < GetBaseRtt ())
+      {
+        m_alphaStale = true;
+      }
+
+    m_baseRttFilter.Update (rtt, m_roundCount);
+    m_maxRttFilter.Update (rtt, m_roundCount);
+
+    m_sumRtt = m_sumRtt + rtt;
+    ++m_cntRtt;
+    m_lastRtt = rtt;
+  }
+
+  /**
+   * \brief Feed an RTT sample, keeping only the lowest of each ACK burst
+   *
+   * ACKs compressed by delayed ACKs, block ACKs or a return path queue
+   * arrive closer together than their data could cross the narrow link,
+   * and the first ACKs of such a burst carry the time their data waited to
+   * be aggregated. An ACK is compressed when it follows the previous one by
+   * less than half the time the data it covers takes at the estimated
+   * capacity. Within a burst only the lowest sample is kept, and it enters
+   * UpdateRtt when the next burst starts.
+   *
+   * \param now arrival time of the ACK
+   * \param rtt the RTT sample, non-zero
+   * \param ackedBytes data covered by the ACK (bytes)
+   * \return true if a burst ended and its sample went to UpdateRtt
+   */
+  bool UpdateRttFiltered (TimeT now, TimeT rtt, uint32_t ackedBytes)
+  {
+    double spacing = TimeTraits::Seconds (now - m_burstLastAck);
+    m_burstLastAck = now;
+    if (m_burstRtt != TimeTraits::Zero () && spacing < 0.5 * ackedBytes / CapacityBytesPerSecond ())
+      {
+        if (rtt < m_burstRtt)
+          {
+            m_burstRtt = rtt;
+          }
+        ++m_compressedAcks;
+        return false;
+      }
+
+    bool flushed = m_burstRtt != TimeTraits::Zero ();
+    if (flushed)
+      {
+        UpdateRtt (m_burstRtt);
+      }
+    m_burstRtt = rtt;
+    return flushed;
+  }
+
+  /// \return number of ACKs UpdateRttFiltered found compressed
+  uint32_t GetCompressedAcks () const { return m_compressedAcks; }
+
+  /**
+   * \brief Congestion avoidance increase for one ACK
+   *
+   * Alpha and the RTT terms only move once per round; the per-ACK work is
+   * a single division by cwnd.
+   *
+   * \param cWnd the congestion window (bytes)
+   * \return the new window (bytes)
+   */
+  uint32_t IncreaseWindow (uint32_t cWnd)
+  {
+    return IncreaseWindow (cWnd, cWnd);
+  }
+
+  /**
+   * \brief Coupled congestion avoidance increase for one ACK
+   *
+   * Dividing by the window of the whole group instead of the flow's own,
+   * as LIA does for equal RTTs, makes the increase per RTT summed over the
+   * group that of a single flow with the aggregate window.
+   *
+   * The increase counts the segments the ACK covers, so delayed or
+   * aggregated ACKs do not slow the growth per RTT.
+   *
+   * \param cWnd the congestion window (bytes)
+   * \param aggregateCwnd sum of the windows of the group, at least cWnd (bytes)
+   * \param segmentsAcked segments covered by the ACK
+   * \return the new window (bytes)
+   */
+  uint32_t IncreaseWindow (uint32_t cWnd, uint32_t aggregateCwnd, uint32_t segmentsAcked = 1)
+  {
+    UpdateControlLaw ();
+    if (m_fixedPoint)
+      {
+        return ApplyWindowDeltaQ16 (cWnd, segmentsAcked
+                                    * TcpLibraFixedPoint::Increase (m_caGainQ16, aggregateCwnd));
+      }
+    return ApplyWindowDelta (cWnd, segmentsAcked * m_caGain / aggregateCwnd);
+  }
+
+  /**
+   * \brief Congestion avoidance step toward a queuing delay target, for one ACK
+   *
+   * As in LEDBAT, with the queuing delay taken as the last RTT minus the
+   * base RTT: off target = (target - delay) / target. Below the target the
+   * Libra increase is scaled by off target, so growth fades as the queue
+   * nears the target; above it the window shrinks by off target segments
+   * per RTT, at most one, so the backlog drains without a sawtooth. Runs in
+   * double precision whatever the fixed-point setting.
+   *
+   * \param cWnd the congestion window (bytes)
+   * \param aggregateCwnd sum of the windows of the coupling group, or cWnd (bytes)
+   * \param target the queuing delay target, positive
+   * \param segmentSize the segment size (bytes)
+   * \param segmentsAcked segments covered by the ACK
+   * \return the new window (bytes)
+   */
+  uint32_t IncreaseWindowToTarget (uint32_t cWnd, uint32_t aggregateCwnd, TimeT target,
+                                   uint32_t segmentSize, uint32_t segmentsAcked = 1)
+  {
+    if (GetBaseRtt () == TimeTraits::Max () || m_lastRtt == TimeTraits::Zero ())
+      {
+        return IncreaseWindow (cWnd, aggregateCwnd, segmentsAcked);
+      }
+
+    UpdateControlLaw ();
+    double targetSeconds = TimeTraits::Seconds (target);
+    double offTarget = (targetSeconds - TimeTraits::Seconds (QueueDelay (m_lastRtt)))
+                       / targetSeconds;
+    if (offTarget >= 0.0)
+      {
+        return ApplyWindowDelta (cWnd, segmentsAcked * offTarget * m_caGain / aggregateCwnd);
+      }
+    double segments = std::max (offTarget, -1.0);
+    return ApplyWindowDelta (cWnd, segmentsAcked * segments * segmentSize * segmentSize
+                             / aggregateCwnd);
+  }
+
+  /**
+   * \brief Decrease for one congestion event
+   * \param cWnd the congestion window (bytes)
+   * \param scale fraction of the Libra decrease to apply, 1 for a loss
+   * \return the new window (bytes)
+   */
+  uint32_t DecreaseWindow (uint32_t cWnd, double scale = 1.0)
+  {
+    return ApplyWindowDeltaQ16 (cWnd, -DecreaseQ16 (cWnd, scale));
+  }
+
+  /**
+   * \brief Window after one decrease, leaving the core alone
+   *
+   * Same decrease as DecreaseWindow, for a value other than cwnd such as
+   * ssthresh: the fraction of a byte is dropped rather than carried, so
+   * the window's own carried fraction is not disturbed.
+   *
+   * \param cWnd the congestion window (bytes)
+   * \param scale fraction of the Libra decrease to apply, 1 for a loss
+   * \return the window after the decrease (bytes)
+   */
+  uint32_t ComputeDecrease (uint32_t cWnd, double scale = 1.0) const
+  {
+    int64_t bytes = DecreaseQ16 (cWnd, scale) / TcpLibraFixedPoint::One;
+    return static_cast<uint32_t> (std::max<int64_t> (static_cast<int64_t> (cWnd) - bytes, 0));
+  }
+
+  /**
+   * \brief Take the path state of a coupling group
+   *
+   * A lower group base RTT enters the base RTT filter like a sample, so a
+   * flow that joined with the queue already standing measures delay from
+   * the true floor. The group capacity stands in until the flow has its
+   * own estimate.
+   *
+   * \param baseRtt the minimum base RTT of the group, Max if none
+   * \param capacity the capacity estimate of the group, zero if none
+   */
+  void ShareGroupState (TimeT baseRtt, RateT capacity)
+  {
+    if (baseRtt < GetBaseRtt ())
+      {
+        m_baseRttFilter.Update (baseRtt, m_roundCount);
+        m_alphaStale = true;
+      }
+    m_groupCapacity = capacity;
+  }
+
+  /**
+   * \brief Tell a congestive loss from a random one by the queue behind it
+   *
+   * A buffer overflow comes with the queue near its peak, so the last RTT
+   * sits close to the maximum; a channel error strikes at any backlog. The
+   * loss counts as congestive when the queuing delay of the last sample is
+   * at least threshold times the maximum queuing delay of the window. With
+   * no queuing delay in the window at all the path never filled, and every
+   * loss counts as random.
+   *
+   * \param threshold fraction of the maximum queuing delay, in [0, 1]
+   * \return true if the loss is congestive, or if there are no samples yet
+   */
+  bool IsCongestiveLoss (double threshold) const
+  {
+    if (GetBaseRtt () == TimeTraits::Max () || m_lastRtt == TimeTraits::Zero ())
+      {
+        return true;
+      }
+    if (!(GetMaxRtt () > GetBaseRtt ()))
+      {
+        return false;
+      }
+    double delay = TimeTraits::Seconds (QueueDelay (m_lastRtt));
+    return delay >= threshold * TimeTraits::Seconds (CalculateMaxDelay ());
+  }
+
+  /**
+   * \brief Recompute alpha and the per-round control law terms if stale
+   */
+  void UpdateControlLaw ()
+  {
+    if (!m_alphaStale)
+      {
+        return;
+      }
+
+    m_penalty = CalculatePenaltyFactor ();
+    m_alpha = m_penalty * CalculateScalabilityFactor ();
+    ++m_lawUpdates;
+    double rtt = TimeTraits::Seconds (m_lastRtt);
+    m_caGain = (m_alpha * rtt * rtt) / (m_t0 + rtt);
+
+    // The same terms for the fixed-point law, from the integer RTT and the
+    // reciprocal of (T0+RTT).
+    uint32_t rttUs = static_cast<uint32_t> (TimeTraits::MicroSeconds (m_lastRtt));
+    uint32_t t0Us = static_cast<uint32_t> (m_t0 * 1e6);
+    m_caGainQ16 = TcpLibraFixedPoint::IncreaseGain (m_alpha, rttUs, t0Us);
+
+    m_alphaStale = false;
+  }
+
+  /// \return average queuing delay: average RTT minus base RTT
+  TimeT CalculateAvgDelay () const
+  {
+    // Prefer the last complete round; during the first one only the running
+    // sum is available.
+    TimeT avgRtt = m_avgRtt;
+    if (avgRtt == TimeTraits::Zero () && m_cntRtt > 0)
+      {
+        avgRtt = static_cast<TimeT> (m_sumRtt / m_cntRtt);
+      }
+    return QueueDelay (avgRtt);
+  }
+
+  /// \return maximum queuing delay: maximum RTT minus base RTT
+  TimeT CalculateMaxDelay () const
+  {
+    return QueueDelay (GetMaxRtt ());
+  }
+
+  /// \return S = k1 * capacity (bytes/s)
+  double CalculateScalabilityFactor () const
+  {
+    return m_k1 * CapacityBytesPerSecond ();
+  }
+
+  /// \return P = exp (-k2 * Qavg / Qmax)
+  double CalculatePenaltyFactor () const
+  {
+    // Without any backlog in the window there is nothing to penalize.
+    double qavg = 0.0;
+    double qmax = 1.0;
+    if (GetMaxRtt () > GetBaseRtt ())
+      {
+        qavg = TimeTraits::Seconds (CalculateAvgDelay ());
+        qmax = TimeTraits::Seconds (CalculateMaxDelay ());
+      }
+
+    double powerExp = m_k2 * qavg / qmax;
+    return m_tableExp ? TcpLibraExpTable::ExpNeg (powerExp) : std::exp (-powerExp);
+  }
+
+private:
+  typedef TcpLibraWindowedFilter<TimeT, TcpLibraMinCompare<TimeT>, uint32_t> RttMinFilter;
+  typedef TcpLibraWindowedFilter<TimeT, TcpLibraMaxCompare<TimeT>, uint32_t> RttMaxFilter;
+  typedef TcpLibraWindowedFilter<RateT, TcpLibraMaxCompare<RateT>, uint32_t> RateMaxFilter;
+
+  /**
+   * \param rtt an RTT
+   * \return rtt minus the base RTT, zero if not above it
+   */
+  TimeT QueueDelay (TimeT rtt) const
+  {
+    // Compared first, so unsigned time types do not wrap.
+    TimeT baseRtt = GetBaseRtt ();
+    return rtt > baseRtt ? rtt - baseRtt : TimeTraits::Zero ();
+  }
+
+  /**
+   * \param a a sequence number
+   * \param b a sequence number
+   * \return true if a is before b, modulo wrap
+   */
+  static bool SeqLess (uint32_t a, uint32_t b)
+  {
+    return static_cast<int32_t> (a - b) < 0;
+  }
+
+  /**
+   * \brief End the current run of sends, making it the probe if it
+   * qualifies and no probe is in flight
+   */
+  void CloseBurst ()
+  {
+    if (m_burstSends >= 2 && m_probeEnd == m_probeStart)
+      {
+        m_probeStart = m_burstStart;
+        m_probeEnd = m_burstEnd;
+        m_probeAck = m_probeStart;
+      }
+    m_burstSends = 0;
+  }
+
+  /**
+   * \brief Remove one instance of a sample from m_capacitySorted
+   * \param sample the sample
+   */
+  void EraseSorted (RateT sample)
+  {
+    m_capacitySorted.erase (std::lower_bound (m_capacitySorted.begin (),
+                                              m_capacitySorted.end (), sample));
+  }
+
+  /**
+   * \return the capacity estimate, else the group's, else the initial
+   * capacity (bytes/s)
+   */
+  double CapacityBytesPerSecond () const
+  {
+    double cr = RateTraits::BytesPerSecond (m_capacity);
+    if (cr <= 0.0)
+      {
+        cr = RateTraits::BytesPerSecond (m_groupCapacity);
+      }
+    if (cr <= 0.0)
+      {
+        cr = RateTraits::BytesPerSecond (m_initialCapacity);
+      }
+    return cr;
+  }
+
+  /**
+   * \brief Libra decrease T1*cwnd/(2*(T0+RTT)) at the last RTT sample
+   * \param cWnd the congestion window (bytes)
+   * \param scale fraction of the decrease to apply
+   * \return the decrease (1/65536 bytes)
+   */
+  int64_t DecreaseQ16 (uint32_t cWnd, double scale) const
+  {
+    if (m_fixedPoint)
+      {
+        // From the RTT now: a factor kept from the last law update would
+        // lag the RTT by up to a round.
+        int64_t factorQ16 = TcpLibraFixedPoint::DecreaseFactor (
+          static_cast<uint32_t> (TimeTraits::MicroSeconds (m_lastRtt)),
+          static_cast<uint32_t> (m_t0 * 1e6), static_cast<uint32_t> (m_t1 * 1e6));
+        int64_t minusQ16 = TcpLibraFixedPoint::Decrease (factorQ16, cWnd);
+        if (scale != 1.0)
+          {
+            minusQ16 = TcpLibraFixedPoint::Scale (minusQ16, scale);
+          }
+        return minusQ16;
+      }
+
+    double rtt = TimeTraits::Seconds (m_lastRtt);
+    double minus = scale * (m_t1 * cWnd) / (2 * (m_t0 + rtt));
+    return static_cast<int64_t> (minus * TcpLibraFixedPoint::One);
+  }
+
+  /**
+   * \brief Add a possibly fractional byte delta to a window
+   * \param cWnd the window before the change (bytes)
+   * \param delta the change to apply (bytes, negative to decrease)
+   * \return the new window (bytes)
+   */
+  uint32_t ApplyWindowDelta (uint32_t cWnd, double delta)
+  {
+    return ApplyWindowDeltaQ16 (cWnd, static_cast<int64_t> (delta * TcpLibraFixedPoint::One));
+  }
+
+  /**
+   * \brief Add a window delta expressed in Q16 bytes
+   *
+   * Whole bytes go to the window, the rest stays in m_cWndCnt and is
+   * carried into the next call, like snd_cwnd_cnt in Linux. Division
+   * truncates toward zero, so increases and decreases keep their own sign
+   * of remainder.
+   *
+   * \param cWnd the window before the change (bytes)
+   * \param deltaQ16 the change to apply (1/65536 bytes)
+   * \return the new window (bytes)
+   */
+  uint32_t ApplyWindowDeltaQ16 (uint32_t cWnd, int64_t deltaQ16)
+  {
+    m_cWndCnt += deltaQ16;
+    int64_t bytes = m_cWndCnt / TcpLibraFixedPoint::One;
+    m_cWndCnt -= bytes * TcpLibraFixedPoint::One;
+    return static_cast<uint32_t> (std::max<int64_t> (static_cast<int64_t> (cWnd) + bytes, 0));
+  }
+
+  // Per-ACK state first, so the congestion avoidance path touches few
+  // cache lines, then by size. With uint32_t times the only padding is a
+  // byte after the flags, four before m_capacity and four inside
+  // m_deliveryRateFilter; libra-scale-bench asserts the resulting size.
+  int64_t m_cWndCnt;          //!< Carried window fraction, in 1/65536 bytes
+  double m_caGain;            //!< alpha*RTT^2/(T0+RTT): the adder times cwnd
+  int64_t m_caGainQ16;        //!< m_caGain in Q16, for the fixed-point law
+  double m_alpha;             //!< Additive increase factor
+  double m_penalty;           //!< Penalty factor of the last control law update
+  typename TimeTraits::Sum m_sumRtt; //!< Sum of the RTT samples of the current round
+  TimeT m_lastRtt;            //!< Last RTT sample
+  TimeT m_avgRtt;             //!< Average RTT of the last complete round
+  TimeT m_probeAckTime;       //!< Arrival time of m_probeAck
+  TimeT m_burstLastAck;       //!< Arrival time of the previous ACK, for UpdateRttFiltered
+  TimeT m_burstRtt;           //!< Lowest RTT of the current ACK burst, zero if none
+  uint32_t m_cntRtt;          //!< Number of RTT measurements during current RTT
+  uint32_t m_roundCount;      //!< Number of RTT rounds elapsed
+  uint32_t m_roundEnd;        //!< Highest sequence sent when the round started
+  uint32_t m_lawUpdates;      //!< Number of control law updates
+  uint32_t m_burstStart;      //!< First sequence of the current run of sends
+  uint32_t m_burstEnd;        //!< Sequence after the current run of sends
+  uint32_t m_burstSends;      //!< Sends in the current run, 0 once it ended
+  uint32_t m_probeStart;      //!< First sequence of the probe
+  uint32_t m_probeEnd;        //!< Sequence after the probe, m_probeStart if none
+  uint32_t m_probeAck;        //!< Last ACK into the probe, m_probeStart if none yet
+  TimeT m_burstTime;          //!< Send time of the current run
+  bool m_alphaStale;          //!< Alpha and m_caGain need recomputing
+  bool m_fixedPoint;          //!< Run the window updates in Q16.16 arithmetic
+  bool m_tableExp;            //!< Evaluate the penalty with TcpLibraExpTable
+  RttMinFilter m_baseRttFilter; //!< Windowed minimum RTT, the base RTT
+  RttMaxFilter m_maxRttFilter;  //!< Windowed maximum RTT
+  RateT m_capacity;           //!< Estimated narrow link capacity, zero if unknown
+  RateT m_groupCapacity;      //!< Capacity estimate of the coupling group, zero if none
+  RateT m_initialCapacity;    //!< Capacity assumed until the first estimate
+  RateMaxFilter m_deliveryRateFilter; //!< Windowed maximum of the delivery rate samples
+  std::vector<RateT> m_capacitySamples; //!< Recent packet-pair samples, a ring
+  std::vector<RateT> m_capacitySorted;  //!< m_capacitySamples in ascending order
+  uint32_t m_capacityHead;    //!< Oldest entry of m_capacitySamples once full
+  uint32_t m_compressedAcks;  //!< ACKs found compressed by UpdateRttFiltered
+  uint32_t m_baseRttWindow;   //!< Length of the minimum RTT window (rounds)
+  uint32_t m_maxRttWindow;    //!< Length of the maximum RTT window (rounds)
+  uint32_t m_capacityWindow;  //!< Number of packet-pair samples to filter
+  uint32_t m_deliveryRateWindow; //!< Length of the delivery rate window (rounds)
+  double m_k1;                //!< Scalability factor gain
+  double m_k2;                //!< Penalty factor exponent gain
+  double m_t0;                //!< T0 (s)
+  double m_t1;                //!< T1 (s)
+};
+
+} // namespace ns3
+
+#endif /* TCPLIBRA_CORE_H */
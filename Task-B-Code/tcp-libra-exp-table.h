@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef TCPLIBRA_EXP_TABLE_H
+#define TCPLIBRA_EXP_TABLE_H
+
+#include <cmath>
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief exp(-x) for the Libra penalty factor, from a compile-time table
+ *
+ * The penalty exponent k2*Qavg/Qmax lies in [0, k2], since the average
+ * backlog never exceeds the maximum one. The table covers [0, Range) in
+ * steps of h = 1/Steps and interpolates linearly between entries; larger
+ * arguments fall back to std::exp.
+ *
+ * Maximum error: linear interpolation of f(x) = exp(-x) is off by at most
+ * h^2/8 times the largest |f''| on the interval. Since f'' = f, that is
+ * below h^2/8 = 1.23e-4 absolute and h^2/8 * exp(h) = 1.27e-4 relative for
+ * h = 1/32. The table entries themselves are exact to a few ulp.
+ */
+class TcpLibraExpTable
+{
+public:
+  static constexpr uint32_t Steps = 32;              //!< Entries per unit of x
+  static constexpr uint32_t Range = 8;               //!< Table covers [0, Range)
+  static constexpr uint32_t Size = Steps * Range + 1; //!< Number of entries
+
+  /**
+   * \brief Evaluate exp(-x)
+   * \param x the argument, expected to be non-negative
+   * \return exp(-x), within h^2/8 * exp(h) relative error on [0, Range)
+   */
+  static double ExpNeg (double x);
+
+private:
+  /**
+   * \brief exp(x) for 0 <= x <= Range by its Taylor series
+   *
+   * All terms are positive, so there is no cancellation; 60 terms reach
+   * double precision up to x = 8.
+   */
+  static constexpr double TaylorExp (double x)
+  {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 60; ++k)
+      {
+        term *= x / k;
+        sum += term;
+      }
+    return sum;
+  }
+
+  /// Table entries exp(-i/Steps), filled at compile time
+  struct Table
+  {
+    double v[Size];
+    constexpr Table () : v ()
+    {
+      for (uint32_t i = 0; i < Size; ++i)
+        {
+          v[i] = 1.0 / TaylorExp (static_cast<double> (i) / Steps);
+        }
+    }
+  };
+};
+
+inline double
+TcpLibraExpTable::ExpNeg (double x)
+{
+  if (!(x >= 0.0 && x < Range))
+    {
+      return std::exp (-x);
+    }
+  static constexpr Table table;
+  double pos = x * Steps;
+  uint32_t i = static_cast<uint32_t> (pos);
+  double frac = pos - i;
+  return table.v[i] + (table.v[i + 1] - table.v[i]) * frac;
+}
+
+} // namespace ns3
+
+#endif /* TCPLIBRA_EXP_TABLE_H */
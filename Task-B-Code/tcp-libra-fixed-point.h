@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef TCPLIBRA_FIXED_POINT_H
+#define TCPLIBRA_FIXED_POINT_H
+
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Q16.16 fixed-point form of the Libra window updates
+ *
+ * RTTs are integer microseconds and window changes are Q16 bytes, the unit
+ * of the TcpLibra window accumulator. The increase gain alpha*RTT^2/(T0+RTT)
+ * is computed once per round, so per ACK only a divide by cwnd remains. The
+ * decrease factor T1/(2*(T0+RTT)) is computed on every decrease from the
+ * RTT at that moment, one integer divide, and multiplied by cwnd and, for a
+ * partial decrease, by a Q16 scale.
+ *
+ * Tolerance against the double-precision law: the decrease factor and the
+ * scale are truncated to 1/65536, so a decrease differs by under
+ * 2*cwnd/65536 bytes; the increase gain keeps 16 fractional bits of the RTT
+ * term (in microseconds), so its relative error is below
+ * 2^-16 * (T0+RTT)/RTT^2, 4e-8 at 20ms.
+ */
+class TcpLibraFixedPoint
+{
+public:
+  static constexpr int Shift = 16;                        //!< Fractional bits
+  static constexpr int64_t One = static_cast<int64_t> (1) << Shift; //!< 1.0 in Q16
+
+  /**
+   * \brief Per-round increase gain alpha*RTT^2/(T0+RTT)
+   * \param alpha the Libra alpha of the round
+   * \param rttUs the round RTT (microseconds)
+   * \param t0Us the T0 parameter (microseconds)
+   * \return the gain in Q16; divided by cwnd it is the per-ACK increase
+   */
+  static int64_t IncreaseGain (double alpha, uint32_t rttUs, uint32_t t0Us)
+  {
+    // RTT^2/(T0+RTT) in Q16 microseconds; rtt^2 << 16 fits up to RTT = 11s.
+    int64_t rtt = rttUs;
+    int64_t rttTermQ16 = (rtt * rtt << Shift) / (rtt + t0Us);
+    return static_cast<int64_t> (alpha * rttTermQ16 / 1e6);
+  }
+
+  /**
+   * \brief Decrease factor T1/(2*(T0+RTT)) at the current RTT
+   * \param rttUs the RTT at the decrease (microseconds)
+   * \param t0Us the T0 parameter (microseconds)
+   * \param t1Us the T1 parameter (microseconds)
+   * \return the factor in Q16
+   */
+  static int64_t DecreaseFactor (uint32_t rttUs, uint32_t t0Us, uint32_t t1Us)
+  {
+    return (static_cast<int64_t> (t1Us) << Shift) / (2 * (static_cast<int64_t> (t0Us) + rttUs));
+  }
+
+  /**
+   * \param gainQ16 the gain from IncreaseGain
+   * \param cWnd the congestion window (bytes)
+   * \return the increase for one ACK, in Q16 bytes
+   */
+  static int64_t Increase (int64_t gainQ16, uint32_t cWnd)
+  {
+    return gainQ16 / cWnd;
+  }
+
+  /**
+   * \param factorQ16 the factor from DecreaseFactor
+   * \param cWnd the congestion window (bytes)
+   * \return the decrease for one loss event, in Q16 bytes
+   */
+  static int64_t Decrease (int64_t factorQ16, uint32_t cWnd)
+  {
+    return factorQ16 * cWnd;
+  }
+
+  /**
+   * \param valueQ16 a Q16 value, such as a decrease
+   * \param scale the factor to apply, in [0, 1]
+   * \return valueQ16 times scale, in Q16
+   */
+  static int64_t Scale (int64_t valueQ16, double scale)
+  {
+    // Whole and fractional parts apart, so a window of any size fits
+    int64_t scaleQ16 = static_cast<int64_t> (scale * One);
+    return (valueQ16 >> Shift) * scaleQ16 + (((valueQ16 & (One - 1)) * scaleQ16) >> Shift);
+  }
+};
+
+} // namespace ns3
+
+#endif /* TCPLIBRA_FIXED_POINT_H */
@@ -0,0 +1,351 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef TCPLIBRA_TRACE_H
+#define TCPLIBRA_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief File header of a TcpLibra ACK trace
+ *
+ * A trace is this header followed by TcpLibraTraceRecord entries up to the
+ * end of the file, in host byte order. The record count follows from the
+ * file size. Times are 32-bit microseconds, so a trace spans at most 71
+ * minutes of simulated time.
+ */
+struct TcpLibraTraceHeader
+{
+  char magic[4];            //!< "LBRT"
+  uint16_t version;         //!< Format version, 2; 1 has no SEND records
+  uint16_t recordSize;      //!< sizeof (TcpLibraTraceRecord)
+  uint32_t segmentSize;     //!< Segment size of the connection (bytes)
+  uint32_t initialCwnd;     //!< cwnd at the first record (bytes)
+  uint32_t initialSsThresh; //!< ssthresh at the first record (bytes)
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief One congestion control call of a TcpLibra connection
+ */
+struct TcpLibraTraceRecord
+{
+  /// Which TcpLibra entry point the record stands for
+  enum Event : uint8_t
+  {
+    PKTS_ACKED = 0,      //!< PktsAcked
+    INCREASE_WINDOW = 1, //!< IncreaseWindow
+    DUPACK = 2,          //!< HandleWindowForDupAck
+    SSTHRESH = 3,        //!< GetSsThresh, on entering recovery, CWR or RTO
+    SLOW_START_EXIT = 4, //!< HyStart set ssthresh to cwnd
+    SEND = 5,            //!< New data sent, segmentsAcked holds the segments
+  };
+
+  uint32_t timeUs;        //!< Simulation time (microseconds)
+  uint32_t rttUs;         //!< RTT sample, 0 if none (microseconds)
+  uint16_t segmentsAcked; //!< Segments acked, for PktsAcked and IncreaseWindow
+  uint8_t event;          //!< An Event value
+  uint8_t reserved;       //!< Zero
+};
+
+static_assert (sizeof (TcpLibraTraceHeader) == 20, "trace header layout");
+static_assert (sizeof (TcpLibraTraceRecord) == 12, "trace record layout");
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Appends TcpLibraTraceRecord entries to a trace file
+ *
+ * Records go through the stdio buffer, so a record costs a copy into it.
+ */
+class TcpLibraTraceWriter
+{
+public:
+  TcpLibraTraceWriter () : m_file (nullptr) {}
+  ~TcpLibraTraceWriter () { Close (); }
+
+  TcpLibraTraceWriter (const TcpLibraTraceWriter&) = delete;
+  TcpLibraTraceWriter& operator= (const TcpLibraTraceWriter&) = delete;
+
+  /**
+   * \brief Create the file and write its header
+   * \param path the file to create
+   * \param segmentSize the segment size (bytes)
+   * \param initialCwnd the congestion window at the first record (bytes)
+   * \param initialSsThresh the slow start threshold at the first record (bytes)
+   * \return true on success
+   */
+  bool Open (const std::string &path, uint32_t segmentSize, uint32_t initialCwnd,
+             uint32_t initialSsThresh)
+  {
+    Close ();
+    m_file = std::fopen (path.c_str (), "wb");
+    if (m_file == nullptr)
+      {
+        return false;
+      }
+    TcpLibraTraceHeader header;
+    std::memcpy (header.magic, "LBRT", 4);
+    header.version = 2;
+    header.recordSize = sizeof (TcpLibraTraceRecord);
+    header.segmentSize = segmentSize;
+    header.initialCwnd = initialCwnd;
+    header.initialSsThresh = initialSsThresh;
+    std::fwrite (&header, sizeof (header), 1, m_file);
+    return true;
+  }
+
+  /// \return true if a file is open
+  bool IsOpen () const
+  {
+    return m_file != nullptr;
+  }
+
+  /**
+   * \brief Append one record
+   * \param timeUs simulation time (microseconds)
+   * \param rttUs RTT sample, 0 if none (microseconds)
+   * \param segmentsAcked segments acked
+   * \param event a TcpLibraTraceRecord::Event
+   */
+  void Write (uint32_t timeUs, uint32_t rttUs, uint16_t segmentsAcked, uint8_t event)
+  {
+    if (m_file == nullptr)
+      {
+        return;
+      }
+    TcpLibraTraceRecord record;
+    record.timeUs = timeUs;
+    record.rttUs = rttUs;
+    record.segmentsAcked = segmentsAcked;
+    record.event = event;
+    record.reserved = 0;
+    std::fwrite (&record, sizeof (record), 1, m_file);
+  }
+
+  /// Flush and close the file
+  void Close ()
+  {
+    if (m_file != nullptr)
+      {
+        std::fclose (m_file);
+        m_file = nullptr;
+      }
+  }
+
+private:
+  std::FILE *m_file; //!< The trace file, null if closed
+};
+
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Binary sink for the TcpLibra internals trace sources
+ *
+ * Samples go into a preallocated single-producer ring of fixed-size
+ * records; a writer thread drains it to the file every millisecond. Push
+ * is a copy and two atomic operations, with no allocation or formatting.
+ * When the writer falls behind and the ring is full, samples are dropped
+ * and counted rather than stalling the simulation.
+ *
+ * The file is a TcpLibraTraceHeader with magic "LBRI" (segment size and
+ * windows zero) followed by Record entries.
+ */
+class TcpLibraTraceRing
+{
+public:
+  /// Which internal a Record holds
+  enum Kind : uint8_t
+  {
+    ALPHA = 0,           //!< Alpha
+    PENALTY = 1,         //!< Penalty factor P
+    AVG_QUEUE_DELAY = 2, //!< Qavg (s)
+    MAX_QUEUE_DELAY = 3, //!< Qmax (s)
+    BASE_RTT = 4,        //!< Base RTT (s)
+    ADDER = 5,           //!< Congestion avoidance increase of one ACK (bytes)
+  };
+
+  /// One sample
+  struct Record
+  {
+    double value;     //!< The sample
+    uint32_t timeUs;  //!< Simulation time (microseconds)
+    uint32_t flowId;  //!< Connection that produced it
+    uint8_t kind;     //!< A Kind value
+    uint8_t reserved[7]; //!< Zero
+  };
+
+  /**
+   * \param capacity ring size in records, rounded up to a power of two
+   */
+  explicit TcpLibraTraceRing (size_t capacity = 1 << 20)
+    : m_file (nullptr),
+      m_head (0),
+      m_tail (0),
+      m_stop (false),
+      m_dropped (0)
+  {
+    size_t size = 1;
+    while (size < capacity)
+      {
+        size <<= 1;
+      }
+    m_buffer.resize (size);
+    m_mask = size - 1;
+  }
+
+  ~TcpLibraTraceRing () { Close (); }
+
+  TcpLibraTraceRing (const TcpLibraTraceRing&) = delete;
+  TcpLibraTraceRing& operator= (const TcpLibraTraceRing&) = delete;
+
+  /**
+   * \brief Create the file and start the writer thread
+   * \param path the file to create
+   * \return true on success
+   */
+  bool Open (const std::string &path)
+  {
+    Close ();
+    m_file = std::fopen (path.c_str (), "wb");
+    if (m_file == nullptr)
+      {
+        return false;
+      }
+    TcpLibraTraceHeader header;
+    std::memset (&header, 0, sizeof (header));
+    std::memcpy (header.magic, "LBRI", 4);
+    // Version 1 had 16-bit flow ids, which wrapped in runs of 65536 or
+    // more connections.
+    header.version = 2;
+    header.recordSize = sizeof (Record);
+    std::fwrite (&header, sizeof (header), 1, m_file);
+    m_stop.store (false);
+    m_thread = std::thread (&TcpLibraTraceRing::Run, this);
+    return true;
+  }
+
+  /// \return true if a file is open
+  bool IsOpen () const
+  {
+    return m_file != nullptr;
+  }
+
+  /**
+   * \brief Queue one sample; from a single thread only
+   * \param timeUs simulation time (microseconds)
+   * \param flowId connection that produced the sample
+   * \param kind a Kind value
+   * \param value the sample
+   */
+  void Push (uint32_t timeUs, uint32_t flowId, uint8_t kind, double value)
+  {
+    uint64_t head = m_head.load (std::memory_order_relaxed);
+    if (head - m_tail.load (std::memory_order_acquire) > m_mask)
+      {
+        ++m_dropped;
+        return;
+      }
+    Record &record = m_buffer[head & m_mask];
+    record.value = value;
+    record.timeUs = timeUs;
+    record.flowId = flowId;
+    record.kind = kind;
+    std::memset (record.reserved, 0, sizeof (record.reserved));
+    m_head.store (head + 1, std::memory_order_release);
+  }
+
+  /// \return number of samples dropped on a full ring
+  uint64_t GetDropped () const
+  {
+    return m_dropped;
+  }
+
+  /// Stop the writer thread, write what is queued and close the file
+  void Close ()
+  {
+    if (m_file == nullptr)
+      {
+        return;
+      }
+    m_stop.store (true);
+    m_thread.join ();
+    Drain ();
+    std::fclose (m_file);
+    m_file = nullptr;
+  }
+
+private:
+  /// Writer thread: drain, then sleep if there was nothing to write
+  void Run ()
+  {
+    while (!m_stop.load ())
+      {
+        if (Drain () == 0)
+          {
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+          }
+      }
+  }
+
+  /// \return number of records written
+  size_t Drain ()
+  {
+    uint64_t tail = m_tail.load (std::memory_order_relaxed);
+    uint64_t head = m_head.load (std::memory_order_acquire);
+    size_t written = 0;
+    while (tail != head)
+      {
+        // Up to the end of the buffer in one write, the wrapped part next.
+        size_t start = tail & m_mask;
+        size_t count = std::min<uint64_t> (head - tail, m_buffer.size () - start);
+        std::fwrite (&m_buffer[start], sizeof (Record), count, m_file);
+        tail += count;
+        written += count;
+        m_tail.store (tail, std::memory_order_release);
+      }
+    return written;
+  }
+
+  std::vector<Record> m_buffer;   //!< The ring
+  size_t m_mask;                  //!< Ring size minus one
+  std::FILE *m_file;              //!< The trace file, null if closed
+  std::atomic<uint64_t> m_head;   //!< Records pushed
+  std::atomic<uint64_t> m_tail;   //!< Records written
+  std::atomic<bool> m_stop;       //!< Tells the writer thread to exit
+  std::thread m_thread;           //!< Writer thread
+  uint64_t m_dropped;             //!< Samples dropped on a full ring
+};
+
+static_assert (sizeof (TcpLibraTraceRing::Record) == 24, "internals record layout");
+
+} // namespace ns3
+
+#endif /* TCPLIBRA_TRACE_H */
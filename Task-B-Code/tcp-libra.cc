@@ -17,8 +17,19 @@
  *
  */
 #include "tcp-libra.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
 #include "tcp-socket-state.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <utility>
 
 namespace ns3 {
 
@@ -26,6 +37,256 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("TcpLibra");
 NS_OBJECT_ENSURE_REGISTERED (TcpLibra);
 
+// Path state cache of TcpLibra connections. Linux tcp_metrics keys entries
+// by destination, but ns-3.35 congestion ops only see TcpSocketState, which
+// carries no address: neither Init nor any later hook can tell where the
+// connection goes. Entries are therefore keyed by the sending node (the
+// context the connection is set up in), which matches the destination only
+// while each node sends to a single peer, as in Wired.cc and hybrid.cc. A
+// node with connections to several hosts shares one entry between them.
+static std::map<uint32_t, TcpLibraMetrics> g_metrics;
+
+// Coupling groups, by sending node and CouplingGroup value. The
+// destination is out of sight for the same reason as above, so flows of one
+// node only share a group when they share the value; a node sending to
+// several peers gives each peer its own.
+static std::map<std::pair<uint32_t, uint32_t>, Ptr<TcpLibraGroup> > g_groups;
+
+// Both are keyed by node ids and stamped with simulation times, which a
+// later simulation in the same process reuses from zero; they go with the
+// simulation that filled them.
+static bool g_clearScheduled = false;
+
+static void
+ClearSharedState (void)
+{
+  g_metrics.clear ();
+  g_groups.clear ();
+  g_clearScheduled = false;
+}
+
+static void
+ScheduleClearSharedState (void)
+{
+  if (!g_clearScheduled)
+    {
+      Simulator::ScheduleDestroy (&ClearSharedState);
+      g_clearScheduled = true;
+    }
+}
+
+// TcpLibraCore keeps times in 32-bit microseconds. Durations saturate, so
+// Time::Max, the base RTT before any sample, maps to the core's maximum and
+// back; timestamps wrap, which the core allows as it only takes their
+// differences.
+static uint32_t
+ToCoreTime (const Time &t)
+{
+  int64_t us = t.GetMicroSeconds ();
+  if (us >= std::numeric_limits<uint32_t>::max ())
+    {
+      return std::numeric_limits<uint32_t>::max ();
+    }
+  return static_cast<uint32_t> (std::max<int64_t> (us, 0));
+}
+
+static Time
+FromCoreTime (uint32_t us)
+{
+  return us == std::numeric_limits<uint32_t>::max () ? Time::Max () : MicroSeconds (us);
+}
+
+static uint32_t
+CoreNow ()
+{
+  return static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ());
+}
+
+static TcpLibraTraceRing *g_internalsSink = 0;
+static uint32_t g_internalsFlowId = 0;
+
+static void
+InternalsDouble (TcpLibraTraceRing *sink, uint32_t flowId, TcpLibraTraceRing::Kind kind,
+                 double oldValue, double newValue)
+{
+  sink->Push (static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ()), flowId, kind, newValue);
+}
+
+static void
+InternalsTime (TcpLibraTraceRing *sink, uint32_t flowId, TcpLibraTraceRing::Kind kind,
+               Time oldValue, Time newValue)
+{
+  sink->Push (static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ()), flowId, kind,
+              newValue.GetSeconds ());
+}
+
+static void
+InternalsAdder (TcpLibraTraceRing *sink, uint32_t flowId, uint32_t cWnd, double adder)
+{
+  sink->Push (static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ()), flowId,
+              TcpLibraTraceRing::ADDER, adder);
+}
+
+TcpLibraGroup::TcpLibraGroup ()
+  : m_totalCwnd (0),
+    m_groupBaseRtt (Time::Max ()),
+    m_groupCapacity (0)
+{
+}
+
+uint32_t
+TcpLibraGroup::Join ()
+{
+  if (!m_free.empty ())
+    {
+      uint32_t member = m_free.back ();
+      m_free.pop_back ();
+      return member;
+    }
+  m_cWnd.push_back (0);
+  m_baseRtt.push_back (Time::Max ());
+  m_capacity.push_back (DataRate (0));
+  return m_cWnd.size () - 1;
+}
+
+void
+TcpLibraGroup::Leave (uint32_t member)
+{
+  UpdateCwnd (member, 0);
+  UpdatePath (member, Time::Max (), DataRate (0));
+  m_free.push_back (member);
+}
+
+void
+TcpLibraGroup::UpdateCwnd (uint32_t member, uint32_t cWnd)
+{
+  m_totalCwnd += cWnd;
+  m_totalCwnd -= m_cWnd[member];
+  m_cWnd[member] = cWnd;
+}
+
+void
+TcpLibraGroup::UpdatePath (uint32_t member, const Time &baseRtt, const DataRate &capacity)
+{
+  m_baseRtt[member] = baseRtt;
+  m_capacity[member] = capacity;
+  // Once a round per member; recomputing keeps the values those of the
+  // current members, so a departed flow's stale minimum does not linger.
+  m_groupBaseRtt = *std::min_element (m_baseRtt.begin (), m_baseRtt.end ());
+  m_groupCapacity = *std::max_element (m_capacity.begin (), m_capacity.end ());
+}
+
+uint32_t
+TcpLibraGroup::GetCwnd () const
+{
+  return static_cast<uint32_t> (std::min<uint64_t> (m_totalCwnd, UINT32_MAX));
+}
+
+Time
+TcpLibraGroup::GetBaseRtt () const
+{
+  return m_groupBaseRtt;
+}
+
+DataRate
+TcpLibraGroup::GetCapacity () const
+{
+  return m_groupCapacity;
+}
+
+uint32_t
+TcpLibraGroup::GetSize () const
+{
+  return m_cWnd.size () - m_free.size ();
+}
+
+/**
+ * \brief Trace source accessor for a member of TcpLibra::Traces
+ *
+ * The trace sources of a connection, six callback lists and their
+ * values, are rarely connected, so TcpLibra keeps them in a block created
+ * by the first connection instead of in every socket. Disconnecting from a block
+ * never created has nothing to do.
+ */
+template <typename T>
+class TcpLibraTracesAccessor : public TraceSourceAccessor
+{
+public:
+  /**
+   * \brief Constructor
+   * \param source the trace source in TcpLibra::Traces
+   */
+  TcpLibraTracesAccessor (T TcpLibra::Traces::*source)
+    : m_source (source)
+  {
+  }
+
+  virtual bool ConnectWithoutContext (ObjectBase *obj, const CallbackBase &cb) const
+  {
+    TcpLibra *libra = dynamic_cast<TcpLibra *> (obj);
+    if (libra == 0)
+      {
+        return false;
+      }
+    (libra->GetTraces ().*m_source).ConnectWithoutContext (cb);
+    return true;
+  }
+
+  virtual bool Connect (ObjectBase *obj, std::string context, const CallbackBase &cb) const
+  {
+    TcpLibra *libra = dynamic_cast<TcpLibra *> (obj);
+    if (libra == 0)
+      {
+        return false;
+      }
+    (libra->GetTraces ().*m_source).Connect (cb, context);
+    return true;
+  }
+
+  virtual bool DisconnectWithoutContext (ObjectBase *obj, const CallbackBase &cb) const
+  {
+    TcpLibra *libra = dynamic_cast<TcpLibra *> (obj);
+    if (libra == 0)
+      {
+        return false;
+      }
+    if (libra->m_traces != nullptr)
+      {
+        (libra->m_traces.get ()->*m_source).DisconnectWithoutContext (cb);
+      }
+    return true;
+  }
+
+  virtual bool Disconnect (ObjectBase *obj, std::string context, const CallbackBase &cb) const
+  {
+    TcpLibra *libra = dynamic_cast<TcpLibra *> (obj);
+    if (libra == 0)
+      {
+        return false;
+      }
+    if (libra->m_traces != nullptr)
+      {
+        (libra->m_traces.get ()->*m_source).Disconnect (cb, context);
+      }
+    return true;
+  }
+
+private:
+  T TcpLibra::Traces::*m_source; //!< The trace source
+};
+
+/**
+ * \brief Create a TcpLibraTracesAccessor
+ * \param source the trace source in TcpLibra::Traces
+ * \return the accessor
+ */
+template <typename T>
+Ptr<const TraceSourceAccessor>
+MakeTcpLibraTracesAccessor (T TcpLibra::Traces::*source)
+{
+  return Ptr<const TraceSourceAccessor> (new TcpLibraTracesAccessor<T> (source), false);
+}
+
 TypeId
 TcpLibra::GetTypeId (void)
 {
@@ -33,36 +294,348 @@ TcpLibra::GetTypeId (void)
     .SetParent<TcpNewReno> ()
     .SetGroupName ("Internet")
     .AddConstructor<TcpLibra> ()
+    .AddAttribute ("InitialCapacity",
+                   "Narrow link capacity assumed until packet-pair samples are available",
+                   DataRateValue (DataRate ("100Mbps")),
+                   MakeDataRateAccessor (&TcpLibra::SetInitialCapacity,
+                                         &TcpLibra::GetInitialCapacity),
+                   MakeDataRateChecker ())
+    .AddAttribute ("CapacitySamples",
+                   "Number of packet-pair samples the capacity estimate is the median of",
+                   UintegerValue (15),
+                   MakeUintegerAccessor (&TcpLibra::SetCapacityWindow,
+                                         &TcpLibra::GetCapacityWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BaseRttWindow",
+                   "Number of RTT rounds the minimum RTT is taken over",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&TcpLibra::SetBaseRttWindow, &TcpLibra::GetBaseRttWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxRttWindow",
+                   "Number of RTT rounds the maximum RTT is taken over",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&TcpLibra::SetMaxRttWindow, &TcpLibra::GetMaxRttWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TableExp",
+                   "Compute the penalty factor with an interpolated exp table "
+                   "(error below 1.3e-4) instead of std::exp",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::SetTableExp, &TcpLibra::GetTableExp),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FixedPoint",
+                   "Run the window increase and decrease in Q16.16 fixed point "
+                   "with integer microsecond RTTs",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::SetFixedPoint, &TcpLibra::GetFixedPoint),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Pacing",
+                   "Compute the socket pacing rate from cwnd, base RTT and capacity "
+                   "(needs TcpSocketState::EnablePacing)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_pacing),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PacingSsGain",
+                   "Pacing rate over cwnd/baseRtt in slow start",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&TcpLibra::m_pacingSsGain),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("PacingCaGain",
+                   "Pacing rate over cwnd/baseRtt in congestion avoidance",
+                   DoubleValue (1.2),
+                   MakeDoubleAccessor (&TcpLibra::m_pacingCaGain),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("HyStart", "Enable (true) or disable (false) hybrid slow start algorithm",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_hystart),
+                   MakeBooleanChecker ())
+    .AddAttribute ("HyStartLowWindow", "Lower bound cWnd for hybrid slow start (segments)",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&TcpLibra::m_hystartLowWindow),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HyStartDetect", "Hybrid Slow Start detection mechanisms:"
+                   "packet train, delay, both",
+                   EnumValue (BOTH),
+                   MakeEnumAccessor (&TcpLibra::m_hystartDetect),
+                   MakeEnumChecker (PACKET_TRAIN, "PACKET_TRAIN",
+                                    DELAY, "DELAY",
+                                    BOTH, "BOTH"))
+    .AddAttribute ("HyStartMinSamples",
+                   "Number of delay samples for detecting the increase of delay",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&TcpLibra::m_hystartMinSamples),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HyStartAckDelta",
+                   "Spacing between ack's indicating train",
+                   TimeValue (MilliSeconds (2)),
+                   MakeTimeAccessor (&TcpLibra::m_hystartAckDelta),
+                   MakeTimeChecker ())
+    .AddAttribute ("HyStartDelayMin",
+                   "Minimum time for hystart algorithm",
+                   TimeValue (MilliSeconds (4)),
+                   MakeTimeAccessor (&TcpLibra::m_hystartDelayMin),
+                   MakeTimeChecker ())
+    .AddAttribute ("HyStartDelayMax",
+                   "Maximum time for hystart algorithm",
+                   TimeValue (MilliSeconds (16)),
+                   MakeTimeAccessor (&TcpLibra::m_hystartDelayMax),
+                   MakeTimeChecker ())
+    .AddAttribute ("RateSample",
+                   "Take the capacity from the delivery rate samples of TcpRateOps "
+                   "and hold cwnd while the flow is application limited",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_rateSample),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DeliveryRateWindow",
+                   "Number of RTT rounds the capacity is the maximum delivery rate of",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&TcpLibra::SetDeliveryRateWindow,
+                                         &TcpLibra::GetDeliveryRateWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TargetDelay",
+                   "Regulate the queuing delay (RTT minus base RTT) toward this target, "
+                   "LEDBAT style, and leave slow start once it is exceeded; 0 for the "
+                   "plain Libra law",
+                   TimeValue (Time (0)),
+                   MakeTimeAccessor (&TcpLibra::m_targetDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("CouplingGroup",
+                   "Couple the sending connections of one node with the same non-zero "
+                   "group: shared base RTT and capacity, and an increase divided by the "
+                   "group's aggregate cwnd as in LIA; 0 for an uncoupled flow. Congestion "
+                   "ops cannot see the destination, so use one group per peer",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&TcpLibra::m_couplingGroup),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Prr",
+                   "Apply the Libra decrease once per recovery episode, through ssthresh, "
+                   "and leave spreading it to PRR (the socket's TcpPrrRecovery, or "
+                   "TcpLibra's own under CongControl); false cuts cwnd by the decrease "
+                   "on the first duplicate ACK of the episode",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_prr),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LossDifferentiation",
+                   "Classify each loss as congestive or random from the queuing delay "
+                   "at the loss, and soften the decrease for random ones",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_lossDiff),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LossDiffThreshold",
+                   "Fraction of the maximum queuing delay at or above which a loss "
+                   "is congestive",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&TcpLibra::m_lossDiffThreshold),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("RandomLossScale",
+                   "Fraction of the decrease applied on a random loss, 0 to skip it",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&TcpLibra::m_randomLossScale),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("MetricsCache",
+                   "Start connections from the base RTT, capacity, ssthresh and alpha "
+                   "cached by earlier TcpLibra connections of the same node. The cache is "
+                   "keyed by the sending node, not the destination, and lasts until "
+                   "Simulator::Destroy",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_metricsCache),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MetricsTimeout",
+                   "Age after which a cached entry is dropped",
+                   TimeValue (Seconds (3600)),
+                   MakeTimeAccessor (&TcpLibra::m_metricsTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("AbcLimit",
+                   "Most segments one ACK may add to cwnd in slow start "
+                   "(RFC 3465 limit L)",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&TcpLibra::m_abcLimit),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ByteCounting",
+                   "Scale the congestion avoidance increase by the segments each ACK "
+                   "covers; false adds one ACK's increase whatever it covers",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_byteCounting),
+                   MakeBooleanChecker ())
+    .AddAttribute ("AckFilter",
+                   "Take the RTT of a burst of compressed ACKs from its lowest sample only",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_ackFilter),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Ecn",
+                   "Negotiate ECN and scale the decrease on ECE by the marked fraction",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpLibra::m_ecn),
+                   MakeBooleanChecker ())
+    .AddAttribute ("EcnShiftG",
+                   "Gain g of the moving average of the marked fraction",
+                   DoubleValue (0.0625),
+                   MakeDoubleAccessor (&TcpLibra::m_ecnG),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("EcnAlphaOnInit",
+                   "Initial value of the marked fraction average",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&TcpLibra::m_ecnAlphaOnInit),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("K1",
+                   "Gain of the scalability factor S = k1 * capacity",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&TcpLibra::SetK1, &TcpLibra::GetK1),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("K2",
+                   "Gain of the penalty exponent P = exp (-k2 * Qavg / Qmax)",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&TcpLibra::SetK2, &TcpLibra::GetK2),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("T0",
+                   "T0 of the increase and decrease terms",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&TcpLibra::SetT0, &TcpLibra::GetT0),
+                   MakeTimeChecker ())
+    .AddAttribute ("T1",
+                   "T1 of the decrease term",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&TcpLibra::SetT1, &TcpLibra::GetT1),
+                   MakeTimeChecker ())
+    .AddAttribute ("TraceFile",
+                   "Record a binary ACK trace for libra-replay to <TraceFile>-<n>.bin, "
+                   "n counting connections; empty to disable",
+                   StringValue (""),
+                   MakeStringAccessor (&TcpLibra::SetTraceFile, &TcpLibra::GetTraceFile),
+                   MakeStringChecker ())
+    .AddTraceSource ("Alpha",
+                     "Alpha of the control law, updated once per round",
+                     MakeTcpLibraTracesAccessor (&TcpLibra::Traces::alpha),
+                     "ns3::TracedValueCallback::Double")
+    .AddTraceSource ("PenaltyFactor",
+                     "Penalty factor P = exp (-k2 * Qavg / Qmax)",
+                     MakeTcpLibraTracesAccessor (&TcpLibra::Traces::penalty),
+                     "ns3::TracedValueCallback::Double")
+    .AddTraceSource ("AvgQueueDelay",
+                     "Qavg: average RTT of the last round minus the base RTT",
+                     MakeTcpLibraTracesAccessor (&TcpLibra::Traces::avgQueueDelay),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("MaxQueueDelay",
+                     "Qmax: maximum RTT minus the base RTT",
+                     MakeTcpLibraTracesAccessor (&TcpLibra::Traces::maxQueueDelay),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("BaseRtt",
+                     "Minimum RTT over the BaseRttWindow",
+                     MakeTcpLibraTracesAccessor (&TcpLibra::Traces::baseRtt),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("Adder",
+                     "Window increase of each congestion avoidance ACK",
+                     MakeTcpLibraTracesAccessor (&TcpLibra::Traces::adder),
+                     "ns3::TcpLibra::AdderTracedCallback")
   ;
   return tid;
 }
 
 TcpLibra::TcpLibra (void) 
 : TcpNewReno (),
-    m_sumRtt (Time (0)),
-    m_baseRtt (Time::Max ()),
-    m_maxRtt (Time::Min ()),
-    m_cntRtt (0),
-    m_alpha (10.0),
-    m_lastRtt (Seconds (0.0))
+    m_core (),
+    m_pacing (false),
+    m_pacingSsGain (2.0),
+    m_pacingCaGain (1.2),
+    m_hystart (false),
+    m_hystartDetect (BOTH),
+    m_hystartLowWindow (16),
+    m_hystartMinSamples (8),
+    m_hystartAckDelta (MilliSeconds (2)),
+    m_hystartDelayMin (MilliSeconds (4)),
+    m_hystartDelayMax (MilliSeconds (16)),
+    m_rateSample (false),
+    m_ecn (false),
+    m_targetDelay (Time (0)),
+    m_couplingGroup (0),
+    m_group (0),
+    m_groupMember (0),
+    m_prr (false),
+    m_episodeDecrease (false),
+    m_lossDiff (false),
+    m_lossDiffThreshold (0.5),
+    m_randomLossScale (0.25),
+    m_randomLosses (0),
+    m_metricsCache (false),
+    m_metricsTimeout (Seconds (3600)),
+    m_metricsKey (Simulator::NO_CONTEXT),
+    m_tcb (0),
+    m_abcLimit (1),
+    m_byteCounting (false),
+    m_ackFilter (false),
+    m_ecnG (0.0625),
+    m_ecnAlphaOnInit (1.0)
 {
   NS_LOG_FUNCTION (this);
 }
 
 TcpLibra::TcpLibra (const TcpLibra& sock)
   : TcpNewReno (sock),
-    m_sumRtt (sock.m_sumRtt),
-    m_baseRtt (sock.m_baseRtt),
-    m_maxRtt (sock.m_maxRtt),
-    m_cntRtt (sock.m_cntRtt),
-    m_alpha (sock.m_alpha),
-    m_lastRtt(sock.m_lastRtt)
+    m_core (sock.m_core),
+    m_pacing (sock.m_pacing),
+    m_pacingSsGain (sock.m_pacingSsGain),
+    m_pacingCaGain (sock.m_pacingCaGain),
+    m_hystart (sock.m_hystart),
+    m_hystartDetect (sock.m_hystartDetect),
+    m_hystartLowWindow (sock.m_hystartLowWindow),
+    m_hystartMinSamples (sock.m_hystartMinSamples),
+    m_hystartAckDelta (sock.m_hystartAckDelta),
+    m_hystartDelayMin (sock.m_hystartDelayMin),
+    m_hystartDelayMax (sock.m_hystartDelayMax),
+    m_rateSample (sock.m_rateSample),
+    m_ecn (sock.m_ecn),
+    m_targetDelay (sock.m_targetDelay),
+    m_couplingGroup (sock.m_couplingGroup),
+    m_group (0),
+    m_groupMember (0),
+    m_prr (sock.m_prr),
+    m_episodeDecrease (false),
+    m_lossDiff (sock.m_lossDiff),
+    m_lossDiffThreshold (sock.m_lossDiffThreshold),
+    m_randomLossScale (sock.m_randomLossScale),
+    m_randomLosses (sock.m_randomLosses),
+    m_metricsCache (sock.m_metricsCache),
+    m_metricsTimeout (sock.m_metricsTimeout),
+    m_metricsKey (Simulator::NO_CONTEXT),
+    m_tcb (0),
+    m_abcLimit (sock.m_abcLimit),
+    m_byteCounting (sock.m_byteCounting),
+    m_ackFilter (sock.m_ackFilter),
+    m_ecnG (sock.m_ecnG),
+    m_ecnAlphaOnInit (sock.m_ecnAlphaOnInit)
 {
   NS_LOG_FUNCTION (this);
+  // Fork copies a listening socket, whose optional blocks hold no
+  // connection state yet; of them only the trace file name is
+  // configuration. Connections to trace sources are not copied, as with
+  // TracedValue.
+  if (sock.m_ackTrace != nullptr)
+    {
+      SetTraceFile (sock.m_ackTrace->prefix);
+    }
 }
 
 TcpLibra::~TcpLibra (void)
 {
+  if (m_tcb != 0)
+    {
+      // The socket is gone, so the connection is closed: keep its final
+      // state, as Linux does from tcp_update_metrics on close.
+      SaveMetrics (m_tcb);
+      if (!m_rateSample)
+        {
+          m_tcb->TraceDisconnectWithoutContext ("HighestSequence",
+                                                MakeCallback (&TcpLibra::HighTxMarkChanged, this));
+        }
+      if (m_ecnState != nullptr)
+        {
+          m_tcb->TraceDisconnectWithoutContext ("EcnState",
+                                                MakeCallback (&TcpLibra::EcnStateChanged, this));
+        }
+    }
+  if (m_group != 0)
+    {
+      m_group->Leave (m_groupMember);
+    }
 }
 
 uint32_t
@@ -70,11 +643,14 @@ TcpLibra::SlowStart (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
 {
   NS_LOG_FUNCTION (this << tcb << segmentsAcked);
 
+  // Byte counting (RFC 3465): an ACK covering several segments, as with
+  // delayed or aggregated ACKs, grows cwnd by up to L segments.
   if (segmentsAcked >= 1)
     {
-      tcb->m_cWnd += tcb->m_segmentSize;
+      uint32_t segments = std::min (segmentsAcked, m_abcLimit);
+      tcb->m_cWnd += segments * tcb->m_segmentSize;
       NS_LOG_INFO ("In SlowStart, updated to cwnd " << tcb->m_cWnd << " ssthresh " << tcb->m_ssThresh);
-      return segmentsAcked - 1;
+      return segmentsAcked - segments;
     }
 
   return 0;
@@ -87,21 +663,34 @@ TcpLibra::CongestionAvoidance (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
 
   if (segmentsAcked > 0)
     {
-      //std::cout<<"Delay: "<<CalculateMaxDelay()<<std::endl;
-      //CalculatePenaltyFactor();
-      CalculateAlpha();
-      //std::cout<<"Congestion Avoidance Updated baseRtt = " << m_baseRtt << " maxRtt = " << m_maxRtt <<
-      //         " sumRtt = " << m_sumRtt<<" lastRtt: "<<m_lastRtt<<std::endl;
-      double T0 = 1.0;
-      double RTT = static_cast<double>(m_lastRtt.GetSeconds());
-      // double adder = static_cast<double> (tcb->m_segmentSize * tcb->m_segmentSize) / tcb->m_cWnd.Get ();
-      // std::cout<<"In cong avoid alpha: "<<m_alpha<<std::endl;
-      double myAdder = (m_alpha*RTT*RTT)/((T0+RTT)*tcb->m_cWnd.Get());
-      // std::cout<<" My adder: "<<myAdder<<" Window: "<<tcb->m_cWnd.Get()<<std::endl;
-      //adder = std::max (1.0, myAdder);
-      tcb->m_cWnd += static_cast<uint32_t> (myAdder);
+      if (!m_byteCounting)
+        {
+          segmentsAcked = 1;
+        }
+      uint32_t aggregateCwnd = tcb->m_cWnd;
+      if (m_group != 0)
+        {
+          aggregateCwnd = std::max (m_group->GetCwnd (), aggregateCwnd);
+        }
+      if (m_targetDelay.IsZero ())
+        {
+          tcb->m_cWnd = m_core.IncreaseWindow (tcb->m_cWnd, aggregateCwnd, segmentsAcked);
+        }
+      else
+        {
+          tcb->m_cWnd = std::max (m_core.IncreaseWindowToTarget (tcb->m_cWnd, aggregateCwnd,
+                                                                 ToCoreTime (m_targetDelay),
+                                                                 tcb->m_segmentSize,
+                                                                 segmentsAcked),
+                                  2 * tcb->m_segmentSize);
+        }
+      PublishControlLaw ();
+      if (m_traces != nullptr)
+        {
+          m_traces->adder (tcb->m_cWnd, segmentsAcked * m_core.GetAdder (aggregateCwnd));
+        }
       NS_LOG_INFO ("In CongAvoid, updated to cwnd " << tcb->m_cWnd <<
-                   " ssthresh " << tcb->m_ssThresh);
+                   " ssthresh " << tcb->m_ssThresh << " alpha " << m_core.GetAlpha ());
     }
 }
 
@@ -111,12 +700,142 @@ TcpLibra::HandleWindowForDupAck(Ptr<TcpSocketState> tcb)
 
   NS_LOG_FUNCTION (this << tcb);
 
-  double T1 = 1.0;
-  double T0 = 1.0;
-  double RTT = static_cast<double>(m_lastRtt.GetSeconds());
-  double minus = (T1*tcb->m_cWnd)/(2*(T0+RTT));
-  tcb->m_cWnd = tcb->m_cWnd - static_cast<uint32_t>(minus);
-  // std::cout<<"Minus: "<<minus<<" CWND: "<<tcb->m_cWnd<<std::endl;
+  RecordTrace (tcb, Time (0), 0, TcpLibraTraceRecord::DUPACK);
+  // With PRR the decrease is taken once, by GetSsThresh on entering
+  // recovery. Without it the first duplicate ACK of an episode cuts cwnd,
+  // unless GetSsThresh took the decrease already; cutting on every one
+  // would compound it down to the floor over a single episode.
+  if (m_prr || m_episodeDecrease)
+    {
+      return;
+    }
+  m_episodeDecrease = true;
+  tcb->m_cWnd = std::max (m_core.DecreaseWindow (tcb->m_cWnd, LossDecreaseScale ()),
+                          2 * tcb->m_segmentSize);
+  PublishControlLaw ();
+}
+
+void
+TcpLibra::CongestionStateSet (Ptr<TcpSocketState> tcb,
+                              const TcpSocketState::TcpCongState_t newState)
+{
+  NS_LOG_FUNCTION (this << tcb << newState);
+
+  if (newState != TcpSocketState::CA_OPEN)
+    {
+      m_core.ResetCapacityProbe ();
+    }
+  else
+    {
+      // The episode is over; the next loss takes a decrease of its own
+      m_episodeDecrease = false;
+    }
+  if (m_ecnState != nullptr)
+    {
+      // Consumed by GetSsThresh just before, or the echo led to no CWR
+      m_ecnState->cwrPending = false;
+    }
+  if (newState == TcpSocketState::CA_RECOVERY && m_prr && HasCongControl ())
+    {
+      m_prrState.reset (new PrrState ());
+      m_prrState->recoverFs = std::max (tcb->m_bytesInFlight.Get (), tcb->m_segmentSize);
+    }
+  else if (newState == TcpSocketState::CA_OPEN && tcb->m_congState == TcpSocketState::CA_RECOVERY
+           && m_prr && HasCongControl ())
+    {
+      // RFC 6937: the episode ends with cwnd at ssthresh.
+      tcb->m_cWnd = tcb->m_ssThresh.Get ();
+    }
+  if (newState != TcpSocketState::CA_RECOVERY)
+    {
+      m_prrState.reset ();
+    }
+  // A reduction or the end of one changes the ssthresh worth keeping
+  SaveMetrics (tcb);
+}
+
+void
+TcpLibra::PrrUpdate (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateSample &rs)
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  int64_t delivered = rs.m_ackedSacked;
+  m_prrState->delivered += rs.m_ackedSacked;
+  m_prrState->lost += rs.m_bytesLoss;
+  int64_t prrDelivered = m_prrState->delivered;
+  int64_t recoverFs = m_prrState->recoverFs;
+  int64_t pipe = tcb->m_bytesInFlight.Get ();
+  int64_t ssThresh = tcb->m_ssThresh.Get ();
+  // Congestion ops are not told what the socket sends. Since RecoverFS the
+  // pipe has lost what was delivered and what was marked lost, and gained
+  // what was sent, new data and retransmissions alike; leaving the lost
+  // bytes out would undercount prr_out in a burst loss and over-send.
+  int64_t prrOut = std::max<int64_t> (pipe + prrDelivered + m_prrState->lost - recoverFs, 0);
+
+  int64_t sndCnt;
+  if (pipe > ssThresh)
+    {
+      sndCnt = (prrDelivered * ssThresh + recoverFs - 1) / recoverFs - prrOut;
+    }
+  else
+    {
+      int64_t limit = std::max (prrDelivered - prrOut, delivered) + tcb->m_segmentSize;
+      sndCnt = std::min (ssThresh - pipe, limit);
+    }
+
+  tcb->m_cWnd = static_cast<uint32_t> (pipe + std::max<int64_t> (sndCnt, 0));
+  NS_LOG_INFO ("PRR: delivered " << prrDelivered << " lost " << m_prrState->lost << " out " <<
+               prrOut << " pipe " << pipe << " cwnd " << tcb->m_cWnd);
+}
+
+double
+TcpLibra::LossDecreaseScale ()
+{
+  if (!m_lossDiff || m_core.IsCongestiveLoss (m_lossDiffThreshold))
+    {
+      return 1.0;
+    }
+
+  ++m_randomLosses;
+  NS_LOG_INFO ("Random loss " << m_randomLosses << ": queuing delay " <<
+               FromCoreTime (m_core.GetLastRtt ()) - FromCoreTime (m_core.GetBaseRtt ()) <<
+               " of " << FromCoreTime (m_core.CalculateMaxDelay ()));
+  return m_randomLossScale;
+}
+
+void
+TcpLibra::UpdateEcnAlpha ()
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_ecnState == nullptr || m_ecnState->ackedBytesTotal == 0)
+    {
+      return;
+    }
+
+  EcnState &ecn = *m_ecnState;
+  double fraction = static_cast<double> (ecn.ackedBytesEcn) / ecn.ackedBytesTotal;
+  ecn.alpha = (1.0 - m_ecnG) * ecn.alpha + m_ecnG * fraction;
+  ecn.ackedBytesEcn = 0;
+  ecn.ackedBytesTotal = 0;
+
+  NS_LOG_INFO ("Marked fraction " << fraction << ", ecnAlpha " << ecn.alpha);
+}
+
+void
+TcpLibra::EcnStateChanged (TcpSocketState::EcnState_t oldValue,
+                           TcpSocketState::EcnState_t newValue)
+{
+  NS_LOG_FUNCTION (this << oldValue << newValue);
+
+  // Only Open and Disorder enter CWR; in CWR, Recovery or Loss the echo
+  // is answered by the reduction already under way.
+  if (newValue == TcpSocketState::ECN_ECE_RCVD
+      && (m_tcb->m_congState == TcpSocketState::CA_OPEN
+          || m_tcb->m_congState == TcpSocketState::CA_DISORDER))
+    {
+      m_ecnState->cwrPending = true;
+    }
 }
 
 void
@@ -124,6 +843,14 @@ TcpLibra::IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
 {
   NS_LOG_FUNCTION (this << tcb << segmentsAcked);
 
+  RecordTrace (tcb, Time (0), segmentsAcked, TcpLibraTraceRecord::INCREASE_WINDOW);
+
+  if (IsAppLimited (tcb))
+    {
+      NS_LOG_INFO ("Application limited, cwnd held at " << tcb->m_cWnd);
+      return;
+    }
+
   if (tcb->m_cWnd < tcb->m_ssThresh)
   {
     segmentsAcked = SlowStart (tcb, segmentsAcked);
@@ -135,6 +862,90 @@ TcpLibra::IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
   }
 }
 
+bool
+TcpLibra::HasCongControl () const
+{
+  // The socket leaves the pacing rate alone when the congestion control
+  // implements CongControl, and only generates rate samples for it then.
+  return m_pacing || m_rateSample;
+}
+
+void
+TcpLibra::CongControl (Ptr<TcpSocketState> tcb,
+                       const TcpRateOps::TcpRateConnection &rc,
+                       const TcpRateOps::TcpRateSample &rs)
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  if (m_rateSample)
+    {
+      UpdateRateSample (rc, rs);
+    }
+  if (m_prrState != nullptr && tcb->m_congState == TcpSocketState::CA_RECOVERY)
+    {
+      PrrUpdate (tcb, rs);
+    }
+  UpdatePacingRate (tcb);
+}
+
+void
+TcpLibra::UpdateRateSample (const TcpRateOps::TcpRateConnection &rc,
+                            const TcpRateOps::TcpRateSample &rs)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_rate == nullptr)
+    {
+      m_rate.reset (new RateState ());
+    }
+  m_rate->delivered = rc.m_delivered;
+  // No sample until the ACK covers a segment with send-time state.
+  if (rs.m_delivered <= 0 || rs.m_interval.IsZero ())
+    {
+      return;
+    }
+
+  m_rate->appLimited = rs.m_isAppLimited;
+  if (m_core.UpdateDeliveryRate (rs.m_deliveryRate, rs.m_isAppLimited))
+    {
+      NS_LOG_INFO ("Delivery rate " << rs.m_deliveryRate << ", capacity estimate " <<
+                   m_core.GetCapacity ());
+    }
+}
+
+bool
+TcpLibra::IsAppLimited (Ptr<const TcpSocketState> tcb) const
+{
+  return m_rate != nullptr && m_rate->appLimited && m_rate->roundDelivered < tcb->m_cWnd / 2;
+}
+
+void
+TcpLibra::UpdatePacingRate (Ptr<TcpSocketState> tcb)
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  Time baseRtt = FromCoreTime (m_core.GetBaseRtt ());
+  if (!m_pacing || baseRtt == Time::Max ())
+    {
+      return;
+    }
+
+  double gain = tcb->m_cWnd < tcb->m_ssThresh ? m_pacingSsGain : m_pacingCaGain;
+  DataRate rate (static_cast<uint64_t> (gain * tcb->m_cWnd.Get () * 8 / baseRtt.GetSeconds ()));
+  // Sending faster than the narrow link only builds its queue. Delivery
+  // rate samples never exceed the sending rate, though, so in that mode the
+  // gain is left as headroom to find more bandwidth.
+  DataRate capacity = m_core.GetCapacity ();
+  if (capacity.GetBitRate () > 0)
+    {
+      double headroom = m_rateSample ? gain : 1.0;
+      rate = std::min (rate, DataRate (static_cast<uint64_t> (headroom * capacity.GetBitRate ())));
+    }
+
+  tcb->m_pacingRate = std::min (rate, tcb->m_maxPacingRate);
+  NS_LOG_INFO ("Pacing rate " << tcb->m_pacingRate);
+}
+
 std::string
 TcpLibra::GetName () const
 {
@@ -142,96 +953,576 @@ TcpLibra::GetName () const
 }
 
 void
-TcpLibra::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t packetsAcked,
-                        const Time &rtt)
+TcpLibra::Init (Ptr<TcpSocketState> tcb)
 {
-  NS_LOG_FUNCTION (this << tcb << packetsAcked << rtt);
+  NS_LOG_FUNCTION (this << tcb);
 
-  if (rtt.IsZero ())
+  if (m_ecn)
+    {
+      tcb->m_useEcn = TcpSocketState::On;
+    }
+  if (tcb->m_useEcn != TcpSocketState::Off && m_ecnState == nullptr)
+    {
+      m_ecnState.reset (new EcnState ());
+      m_ecnState->alpha = m_ecnAlphaOnInit;
+      tcb->TraceConnectWithoutContext ("EcnState",
+                                       MakeCallback (&TcpLibra::EcnStateChanged, this));
+    }
+  if (g_internalsSink != 0)
+    {
+      ConnectInternalsSink ();
+    }
+  // Init runs once the handshake completes, before the first flight is
+  // sent, so the warm start sizes that flight.
+  if (m_tcb == 0)
+    {
+      m_tcb = tcb;
+      if (m_metricsCache)
+        {
+          m_metricsKey = Simulator::GetContext ();
+          LoadMetrics (tcb);
+        }
+      // The packet-pair probes are made of new data, which moves the high
+      // transmit mark once per segment as it is sent. Paced segments never
+      // leave together, so with Pacing the estimate needs RateSample.
+      if (!m_rateSample)
+        {
+          tcb->TraceConnectWithoutContext ("HighestSequence",
+                                           MakeCallback (&TcpLibra::HighTxMarkChanged, this));
+        }
+    }
+}
+
+void
+TcpLibra::SetInternalsSink (TcpLibraTraceRing *sink)
+{
+  g_internalsSink = sink;
+}
+
+void
+TcpLibra::ConnectInternalsSink ()
+{
+  NS_LOG_FUNCTION (this);
+
+  TcpLibraTraceRing *sink = g_internalsSink;
+  uint32_t flowId = g_internalsFlowId++;
+  Traces &traces = GetTraces ();
+  traces.alpha.ConnectWithoutContext (
+    MakeBoundCallback (&InternalsDouble, sink, flowId, TcpLibraTraceRing::ALPHA));
+  traces.penalty.ConnectWithoutContext (
+    MakeBoundCallback (&InternalsDouble, sink, flowId, TcpLibraTraceRing::PENALTY));
+  traces.avgQueueDelay.ConnectWithoutContext (
+    MakeBoundCallback (&InternalsTime, sink, flowId, TcpLibraTraceRing::AVG_QUEUE_DELAY));
+  traces.maxQueueDelay.ConnectWithoutContext (
+    MakeBoundCallback (&InternalsTime, sink, flowId, TcpLibraTraceRing::MAX_QUEUE_DELAY));
+  traces.baseRtt.ConnectWithoutContext (
+    MakeBoundCallback (&InternalsTime, sink, flowId, TcpLibraTraceRing::BASE_RTT));
+  traces.adder.ConnectWithoutContext (MakeBoundCallback (&InternalsAdder, sink, flowId));
+}
+
+TcpLibra::Traces &
+TcpLibra::GetTraces ()
+{
+  if (m_traces == nullptr)
+    {
+      // Nothing is connected yet, so taking the current values fires nothing
+      m_traces.reset (new Traces ());
+      m_traces->lawUpdates = m_core.GetLawUpdates ();
+      m_traces->alpha = m_core.GetAlpha ();
+      m_traces->penalty = m_core.GetPenalty ();
+      m_traces->avgQueueDelay = FromCoreTime (m_core.CalculateAvgDelay ());
+      m_traces->maxQueueDelay = FromCoreTime (m_core.CalculateMaxDelay ());
+      m_traces->baseRtt = FromCoreTime (m_core.GetBaseRtt ());
+    }
+  return *m_traces;
+}
+
+void
+TcpLibra::PublishControlLaw ()
+{
+  // Trace sources only move when the core recomputed the law, once a round.
+  if (m_traces == nullptr || m_core.GetLawUpdates () == m_traces->lawUpdates)
     {
       return;
     }
+  m_traces->lawUpdates = m_core.GetLawUpdates ();
+  m_traces->alpha = m_core.GetAlpha ();
+  m_traces->penalty = m_core.GetPenalty ();
+  m_traces->avgQueueDelay = FromCoreTime (m_core.CalculateAvgDelay ());
+  m_traces->maxQueueDelay = FromCoreTime (m_core.CalculateMaxDelay ());
+}
 
-  //std::cout<<"Before Updated baseRtt = " << m_baseRtt << " maxRtt = " << m_maxRtt <<
-  //             " sumRtt = " << m_sumRtt<<" lastRtt: "<<m_lastRtt<<std::endl;
+void
+TcpLibra::SetTraceFile (std::string prefix)
+{
+  if (prefix.empty ())
+    {
+      m_ackTrace.reset ();
+      return;
+    }
+  if (m_ackTrace == nullptr)
+    {
+      m_ackTrace.reset (new AckTrace ());
+    }
+  m_ackTrace->prefix = prefix;
+}
 
-  // Keep track of minimum RTT
-  m_baseRtt = std::min (m_baseRtt, rtt);
+std::string
+TcpLibra::GetTraceFile () const
+{
+  return m_ackTrace != nullptr ? m_ackTrace->prefix : "";
+}
 
-  // Keep track of maximum RTT
-  m_maxRtt = std::max (rtt, m_maxRtt);
+void
+TcpLibra::SetBaseRttWindow (uint32_t rounds)
+{
+  m_core.SetBaseRttWindow (rounds);
+}
 
-  m_sumRtt += rtt;
+uint32_t
+TcpLibra::GetBaseRttWindow () const
+{
+  return m_core.GetBaseRttWindow ();
+}
 
-  ++m_cntRtt;
-  // keep track of the last rtt sample
-  m_lastRtt = rtt;
+void
+TcpLibra::SetMaxRttWindow (uint32_t rounds)
+{
+  m_core.SetMaxRttWindow (rounds);
+}
 
-  //std::cout<<"After Updated baseRtt = " << m_baseRtt << " maxRtt = " << m_maxRtt <<
-  //             " sumRtt = " << m_sumRtt<<" lastRtt: "<<m_lastRtt<<" "<<m_cntRtt<<" "<<packetsAcked<<std::endl;
+uint32_t
+TcpLibra::GetMaxRttWindow () const
+{
+  return m_core.GetMaxRttWindow ();
+}
+
+void
+TcpLibra::SetInitialCapacity (DataRate rate)
+{
+  m_core.SetInitialCapacity (rate);
+}
+
+DataRate
+TcpLibra::GetInitialCapacity () const
+{
+  return m_core.GetInitialCapacity ();
+}
+
+void
+TcpLibra::SetCapacityWindow (uint32_t samples)
+{
+  m_core.SetCapacityWindow (samples);
+}
 
-  NS_LOG_INFO ("Updated baseRtt = " << m_baseRtt << " maxRtt = " << m_maxRtt <<
-               " sumRtt = " << m_sumRtt<<" lastRtt: "<<m_lastRtt);
+uint32_t
+TcpLibra::GetCapacityWindow () const
+{
+  return m_core.GetCapacityWindow ();
+}
+
+void
+TcpLibra::SetDeliveryRateWindow (uint32_t rounds)
+{
+  m_core.SetDeliveryRateWindow (rounds);
+}
+
+uint32_t
+TcpLibra::GetDeliveryRateWindow () const
+{
+  return m_core.GetDeliveryRateWindow ();
+}
+
+void
+TcpLibra::SetFixedPoint (bool enable)
+{
+  m_core.SetFixedPoint (enable);
+}
+
+bool
+TcpLibra::GetFixedPoint () const
+{
+  return m_core.GetFixedPoint ();
+}
+
+void
+TcpLibra::SetTableExp (bool enable)
+{
+  m_core.SetTableExp (enable);
+}
+
+bool
+TcpLibra::GetTableExp () const
+{
+  return m_core.GetTableExp ();
+}
+
+void
+TcpLibra::SetK1 (double k1)
+{
+  m_core.SetK1 (k1);
+}
+
+double
+TcpLibra::GetK1 () const
+{
+  return m_core.GetK1 ();
+}
+
+void
+TcpLibra::SetK2 (double k2)
+{
+  m_core.SetK2 (k2);
+}
+
+double
+TcpLibra::GetK2 () const
+{
+  return m_core.GetK2 ();
+}
+
+void
+TcpLibra::SetT0 (Time t0)
+{
+  m_core.SetT0 (t0.GetSeconds ());
 }
 
 Time
-TcpLibra::CalculateAvgDelay () const
+TcpLibra::GetT0 () const
 {
-  NS_LOG_FUNCTION (this);
+  return Seconds (m_core.GetT0 ());
+}
 
-   return (m_sumRtt / m_cntRtt - m_baseRtt);
-  //return (m_lastRtt - m_baseRtt);
+void
+TcpLibra::SetT1 (Time t1)
+{
+  m_core.SetT1 (t1.GetSeconds ());
 }
 
 Time
-TcpLibra::CalculateMaxDelay () const
+TcpLibra::GetT1 () const
 {
-  NS_LOG_FUNCTION (this);
-  //std::cout << "Max: "<<m_maxRtt<<"Min: "<<m_baseRtt<<std::endl;
-  return (m_maxRtt - m_baseRtt);
+  return Seconds (m_core.GetT1 ());
 }
 
-double
-TcpLibra::CalculateScalabilityFactor() const
+void
+TcpLibra::RecordTrace (Ptr<const TcpSocketState> tcb, const Time &rtt, uint32_t segmentsAcked,
+                       uint8_t event)
 {
-    NS_LOG_FUNCTION (this);
+  if (m_ackTrace == nullptr)
+    {
+      return;
+    }
+
+  TcpLibraTraceWriter &writer = m_ackTrace->writer;
+  if (!writer.IsOpen ())
+    {
+      static uint32_t traceIndex = 0;
+      std::ostringstream path;
+      path << m_ackTrace->prefix << "-" << traceIndex++ << ".bin";
+      if (!writer.Open (path.str (), tcb->m_segmentSize, tcb->m_cWnd, tcb->m_ssThresh))
+        {
+          NS_LOG_WARN ("Cannot open " << path.str () << ", ACK trace disabled");
+          m_ackTrace.reset ();
+          return;
+        }
+    }
 
-    double k1 = 2.0;
-    double Cr = 100000000/8; // bottleneck capacity = 100Mbps
+  writer.Write (static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ()),
+                 static_cast<uint32_t> (rtt.GetMicroSeconds ()),
+                 static_cast<uint16_t> (std::min<uint32_t> (segmentsAcked, UINT16_MAX)), event);
+}
 
-    double S = k1*Cr;
-    //std::cout<<"Scale: "<<S<<std::endl;
-    return S;
+void
+TcpLibra::HighTxMarkChanged (SequenceNumber32 oldValue, SequenceNumber32 newValue)
+{
+  NS_LOG_FUNCTION (this << oldValue << newValue);
+
+  m_core.OnSend (CoreNow (), oldValue.GetValue (), newValue.GetValue ());
+  uint32_t bytes = newValue.GetValue () - oldValue.GetValue ();
+  RecordTrace (m_tcb, Time (0), (bytes + m_tcb->m_segmentSize - 1) / m_tcb->m_segmentSize,
+               TcpLibraTraceRecord::SEND);
 }
 
-double
-TcpLibra::CalculatePenaltyFactor() const
+void
+TcpLibra::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t packetsAcked,
+                        const Time &rtt)
 {
-    NS_LOG_FUNCTION (this);
-    double Qavg = 1.0;
-    double Qmax = 1.0;
-    if(m_cntRtt > 0){
-      Qavg = static_cast<double> (CalculateMaxDelay ().GetMilliSeconds ());
-      Qmax = static_cast<double> (CalculateAvgDelay ().GetMilliSeconds ());
+  NS_LOG_FUNCTION (this << tcb << packetsAcked << rtt);
+
+  RecordTrace (tcb, rtt, packetsAcked, TcpLibraTraceRecord::PKTS_ACKED);
+
+  // Join on the first acked data rather than in Init: the receiving end
+  // of a connection runs TcpLibra too, but never gets data acked.
+  if (m_couplingGroup != 0 && m_group == 0 && packetsAcked > 0)
+    {
+      ScheduleClearSharedState ();
+      Ptr<TcpLibraGroup> &group = g_groups[std::make_pair (Simulator::GetContext (),
+                                                           m_couplingGroup)];
+      if (group == 0)
+        {
+          group = Create<TcpLibraGroup> ();
+        }
+      m_group = group;
+      m_groupMember = m_group->Join ();
+      NS_LOG_INFO ("Joined coupling group " << m_couplingGroup << " of node " <<
+                   Simulator::GetContext () << ", " << m_group->GetSize () << " members");
+    }
+  if (m_group != 0)
+    {
+      m_group->UpdateCwnd (m_groupMember, tcb->m_cWnd);
+    }
+  // Congestion ops are not told when the socket closes, and the socket may
+  // outlive the connection by long. Everything sent being acked is the end
+  // of a transfer as far as they can see, so save then too.
+  if (m_metricsKey != Simulator::NO_CONTEXT && tcb->m_lastAckedSeq >= tcb->m_highTxMark)
+    {
+      SaveMetrics (tcb);
+    }
+
+  // Only in Open does the cumulative ACK follow the probe segments one by
+  // one; CongestionStateSet drops the probe on leaving it.
+  if (!m_rateSample && tcb->m_congState == TcpSocketState::CA_OPEN
+      && m_core.UpdateCapacityEstimate (CoreNow (), tcb->m_lastAckedSeq.GetValue ()))
+    {
+      NS_LOG_INFO ("Capacity estimate " << m_core.GetCapacity ());
+    }
+
+  // The socket keeps ECN_ECE_RCVD until the reduction it triggered is over,
+  // so this counts the bytes acked under the echoed mark, as in TcpDctcp.
+  if (m_ecnState != nullptr)
+    {
+      m_ecnState->ackedBytesTotal += packetsAcked * tcb->m_segmentSize;
+      if (tcb->m_ecnState == TcpSocketState::ECN_ECE_RCVD)
+        {
+          m_ecnState->ackedBytesEcn += packetsAcked * tcb->m_segmentSize;
+        }
+    }
+
+  if (rtt.IsZero ())
+    {
+      return;
+    }
+
+  UpdateRound (tcb);
+  // The core rounds RTTs to whole microseconds, and zero means no sample.
+  uint32_t rttUs = std::max<uint32_t> (ToCoreTime (rtt), 1);
+  if (m_ackFilter)
+    {
+      m_core.UpdateRttFiltered (CoreNow (), rttUs, packetsAcked * tcb->m_segmentSize);
+    }
+  else
+    {
+      m_core.UpdateRtt (rttUs);
+    }
+  if (m_traces != nullptr)
+    {
+      // Fires only when the base RTT moved
+      m_traces->baseRtt = FromCoreTime (m_core.GetBaseRtt ());
+    }
+
+  if (m_hystart && tcb->m_cWnd < tcb->m_ssThresh
+      && tcb->m_cWnd >= m_hystartLowWindow * tcb->m_segmentSize)
+    {
+      HystartUpdate (tcb, rtt);
+    }
+
+  // Slow start doubles the queue every round; with a delay target, stop
+  // as soon as the target is reached rather than at the first loss.
+  if (!m_targetDelay.IsZero () && tcb->m_cWnd < tcb->m_ssThresh
+      && rtt - FromCoreTime (m_core.GetBaseRtt ()) > m_targetDelay)
+    {
+      NS_LOG_INFO ("Queuing delay above target, leaving slow start at cwnd " << tcb->m_cWnd);
+      tcb->m_ssThresh = tcb->m_cWnd;
+      RecordTrace (tcb, rtt, 0, TcpLibraTraceRecord::SLOW_START_EXIT);
+    }
+
+  NS_LOG_INFO ("Updated baseRtt = " << FromCoreTime (m_core.GetBaseRtt ()) <<
+               " maxRtt = " << FromCoreTime (m_core.GetMaxRtt ()) <<
+               " sumRtt = " << MicroSeconds (m_core.GetSumRtt ()) <<
+               " lastRtt: " << FromCoreTime (m_core.GetLastRtt ()));
+}
+
+void
+TcpLibra::UpdateRound (Ptr<TcpSocketState> tcb)
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  if (!m_core.UpdateRound (tcb->m_lastAckedSeq.GetValue (), tcb->m_highTxMark.Get ().GetValue ()))
+    {
+      return;
+    }
+
+  // HyStart only looks for the end of slow start; its state goes with it
+  // and comes back if an RTO restarts slow start.
+  if (m_hystart && tcb->m_cWnd < tcb->m_ssThresh)
+    {
+      HystartReset ();
+    }
+  else
+    {
+      m_hs.reset ();
+    }
+  UpdateEcnAlpha ();
+  if (m_rate != nullptr)
+    {
+      m_rate->roundDelivered = m_rate->delivered - m_rate->roundStartDelivered;
+      m_rate->roundStartDelivered = m_rate->delivered;
+    }
+  if (m_group != 0)
+    {
+      m_group->UpdatePath (m_groupMember, FromCoreTime (m_core.GetBaseRtt ()),
+                           m_core.GetCapacity ());
+      m_core.ShareGroupState (ToCoreTime (m_group->GetBaseRtt ()), m_group->GetCapacity ());
+    }
+
+  NS_LOG_INFO ("Round " << m_core.GetRoundCount () << " ends at " << m_core.GetRoundEnd () <<
+               ", last round average RTT " << FromCoreTime (m_core.GetAvgRtt ()));
+}
+
+void
+TcpLibra::LoadMetrics (Ptr<TcpSocketState> tcb)
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  auto it = g_metrics.find (m_metricsKey);
+  if (it == g_metrics.end ())
+    {
+      return;
+    }
+  if (Simulator::Now () - it->second.updated > m_metricsTimeout)
+    {
+      g_metrics.erase (it);
+      return;
+    }
+
+  const TcpLibraMetrics &metrics = it->second;
+  m_core.WarmStart (ToCoreTime (metrics.baseRtt), metrics.capacity, metrics.alpha);
+  if (m_traces != nullptr)
+    {
+      m_traces->baseRtt = metrics.baseRtt;
+      m_traces->alpha = metrics.alpha;
+    }
+
+  uint32_t bdp = static_cast<uint32_t> (metrics.capacity.GetBitRate () / 8.0
+                                        * metrics.baseRtt.GetSeconds ());
+  tcb->m_ssThresh = std::max (metrics.ssThresh, 2 * tcb->m_segmentSize);
+  uint32_t cWnd = std::min (tcb->m_ssThresh.Get (), bdp) / 2;
+  cWnd -= cWnd % tcb->m_segmentSize;
+  tcb->m_cWnd = std::max (tcb->m_cWnd.Get (), cWnd);
+
+  NS_LOG_INFO ("Warm start: baseRtt " << metrics.baseRtt << " capacity " << metrics.capacity <<
+               " cwnd " << tcb->m_cWnd << " ssthresh " << tcb->m_ssThresh);
+}
+
+void
+TcpLibra::SaveMetrics (Ptr<const TcpSocketState> tcb)
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  if (m_metricsKey == Simulator::NO_CONTEXT || FromCoreTime (m_core.GetBaseRtt ()) == Time::Max ())
+    {
+      return;
+    }
+
+  ScheduleClearSharedState ();
+  auto it = g_metrics.find (m_metricsKey);
+  bool fresh = it != g_metrics.end ()
+    && Simulator::Now () - it->second.updated <= m_metricsTimeout;
+  TcpLibraMetrics &metrics = g_metrics[m_metricsKey];
+  // As in Linux tcp_update_metrics: in slow start only half the window is
+  // known to be safe, and only raises the cached value; after a reduction
+  // the threshold it set is the better guess.
+  uint32_t ssThresh = tcb->m_cWnd / 2;
+  if (tcb->m_cWnd < tcb->m_ssThresh)
+    {
+      if (fresh)
+        {
+          ssThresh = std::max (ssThresh, metrics.ssThresh);
+        }
+    }
+  else
+    {
+      ssThresh = std::max (ssThresh, tcb->m_ssThresh.Get ());
     }
 
-    //std::cout<<"Qavg: "<<Qavg<<" Qmax: "<<Qmax<<std::endl;
+  metrics.baseRtt = FromCoreTime (m_core.GetBaseRtt ());
+  metrics.capacity = m_core.GetCapacity ();
+  metrics.ssThresh = ssThresh;
+  metrics.alpha = m_core.GetAlpha ();
+  metrics.updated = Simulator::Now ();
+}
 
-    double k2 = 2.0;
-    double powerExp = k2*Qavg/Qmax;
+void
+TcpLibra::HystartReset ()
+{
+  NS_LOG_FUNCTION (this);
 
-    double P = exp(-powerExp);
-    //std::cout<<"Penalty: "<<P<<std::endl;
-    return P;
+  if (m_hs == nullptr)
+    {
+      m_hs.reset (new HystartState ());
+    }
+  m_hs->roundStart = m_hs->lastAck = Simulator::Now ();
+  m_hs->currRtt = Time (0);
+  m_hs->sampleCnt = 0;
+  m_hs->found = 0;
 }
 
 void
-TcpLibra::CalculateAlpha()
+TcpLibra::HystartUpdate (Ptr<TcpSocketState> tcb, const Time &rtt)
 {
-    NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << tcb << rtt);
+
+  if (m_hs == nullptr)
+    {
+      // Slow start from the start of the connection or after an RTO: no
+      // train is timed until the first round starts.
+      m_hs.reset (new HystartState ());
+    }
+  HystartState &hs = *m_hs;
+  if (hs.found & m_hystartDetect)
+    {
+      return;
+    }
+
+  // First detection parameter: ACK train
+  Time baseRtt = FromCoreTime (m_core.GetBaseRtt ());
+  Time now = Simulator::Now ();
+  if ((now - hs.lastAck) <= m_hystartAckDelta)
+    {
+      hs.lastAck = now;
+      if ((now - hs.roundStart) > baseRtt / 2)
+        {
+          hs.found |= PACKET_TRAIN;
+        }
+    }
+
+  // Second detection parameter: minimum delay of the first samples of the
+  // round against the base RTT
+  if (hs.sampleCnt < m_hystartMinSamples)
+    {
+      if (hs.currRtt.IsZero () || hs.currRtt > rtt)
+        {
+          hs.currRtt = rtt;
+        }
+      ++hs.sampleCnt;
+    }
+  else
+    {
+      Time thresh = std::min (std::max (baseRtt / 8, m_hystartDelayMin), m_hystartDelayMax);
+      if (hs.currRtt > baseRtt + thresh)
+        {
+          hs.found |= DELAY;
+        }
+    }
 
-    m_alpha = (CalculatePenaltyFactor() * CalculateScalabilityFactor());   
-    //std::cout<<"In calc alpha: "<<m_alpha<<std::endl;
+  if (hs.found & m_hystartDetect)
+    {
+      NS_LOG_INFO ("HyStart exit (" << static_cast<uint32_t> (hs.found) << ") at cwnd " <<
+                   tcb->m_cWnd);
+      tcb->m_ssThresh = tcb->m_cWnd;
+      RecordTrace (tcb, rtt, 0, TcpLibraTraceRecord::SLOW_START_EXIT);
+    }
 }
 
 uint32_t
@@ -239,16 +1530,41 @@ TcpLibra::GetSsThresh (Ptr<const TcpSocketState> state,
                          uint32_t bytesInFlight)
 {
   NS_LOG_FUNCTION (this << state << bytesInFlight);
-  double T1 = 1.0;
-  double T0 = 1.0;
-  uint32_t temp = state->m_cWnd;
-  double RTT = static_cast<double>(m_lastRtt.GetSeconds());
-  double minus = (T1*state->m_cWnd)/(2*(T0+RTT));
-  temp = temp - static_cast<uint32_t>(minus);
-  // std::cout<<"bytesInFlight "<< bytesInFlight <<" max: "<< std::max (2 * state->m_segmentSize, bytesInFlight / 2)<<" "<<temp<<std::endl;
-  // return temp;
-  return std::max (temp, bytesInFlight / 2);
-  // return std::max (2 * state->m_segmentSize, bytesInFlight / 2);
+
+  RecordTrace (state, Time (0), 0, TcpLibraTraceRecord::SSTHRESH);
+
+  if (!m_prr)
+    {
+      if (m_episodeDecrease)
+        {
+          // A duplicate ACK already cut cwnd for this episode
+          return std::max (std::max (state->m_cWnd.Get (), bytesInFlight / 2),
+                           2 * state->m_segmentSize);
+        }
+      m_episodeDecrease = true;
+    }
+
+  // An ECN echo carries no loss: its CWR takes the Libra decrease scaled
+  // by the smoothed fraction of marked bytes, so light marking costs
+  // little window. Recovery and RTO always take the loss decrease, even
+  // while the socket still holds ECN_ECE_RCVD.
+  if (m_ecnState != nullptr && m_ecnState->cwrPending)
+    {
+      m_ecnState->cwrPending = false;
+      uint32_t ssThresh = Reduce (state, bytesInFlight, m_ecnState->alpha);
+      NS_LOG_INFO ("ECN reduction, ecnAlpha " << m_ecnState->alpha << ", ssthresh " << ssThresh);
+      return ssThresh;
+    }
+  return Reduce (state, bytesInFlight, LossDecreaseScale ());
+}
+
+uint32_t
+TcpLibra::Reduce (Ptr<const TcpSocketState> tcb, uint32_t bytesInFlight, double scale)
+{
+  // ssthresh is not cwnd: the core's carried window fraction stays put
+  uint32_t temp = m_core.ComputeDecrease (tcb->m_cWnd, scale);
+  PublishControlLaw ();
+  return std::max (std::max (temp, bytesInFlight / 2), 2 * tcb->m_segmentSize);
 }
 
 Ptr<TcpCongestionOps>
@@ -20,9 +20,107 @@
 #define TCPLIBRA_H
 
 #include "tcp-congestion-ops.h"
+#include "tcp-libra-core.h"
+#include "tcp-libra-trace.h"
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/sequence-number.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace ns3 {
 
+/// ns3::DataRate for TcpLibraCore
+template <>
+struct TcpLibraRateTraits<DataRate>
+{
+  static double BytesPerSecond (const DataRate &r) { return r.GetBitRate () / 8.0; }
+  static DataRate FromBytesPerSecond (double r) { return DataRate (static_cast<uint64_t> (r * 8)); }
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Path state TcpLibra caches for later connections of a node
+ *
+ * Like Linux tcp_metrics: written when a connection changes congestion
+ * state, when all it sent is acked and when it is destroyed, read by new
+ * connections in Init, and dropped once older than the MetricsTimeout
+ * attribute.
+ */
+struct TcpLibraMetrics
+{
+  Time baseRtt;      //!< Minimum RTT
+  DataRate capacity; //!< Capacity estimate, zero if none
+  uint32_t ssThresh; //!< Slow start threshold for the next connection (bytes)
+  double alpha;      //!< Alpha of the last control law update
+  Time updated;      //!< When the entry was last written
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief State shared by the TcpLibra connections of a coupling group
+ *
+ * A group holds the sending connections of one node with the same
+ * CouplingGroup value; a connection joins once it has data acked.
+ * Members report their cwnd on every ACK and their base RTT and capacity
+ * estimate once a round. The group gives back the aggregate cwnd, which
+ * couples the increase, and the lowest base RTT and highest capacity of
+ * its current members.
+ */
+class TcpLibraGroup : public SimpleRefCount<TcpLibraGroup>
+{
+public:
+  TcpLibraGroup ();
+
+  /**
+   * \brief Add a member
+   * \return the member id
+   */
+  uint32_t Join ();
+  /**
+   * \brief Remove a member and its contribution
+   * \param member the member id
+   */
+  void Leave (uint32_t member);
+  /**
+   * \brief Report the cwnd of a member
+   * \param member the member id
+   * \param cWnd the congestion window (bytes)
+   */
+  void UpdateCwnd (uint32_t member, uint32_t cWnd);
+  /**
+   * \brief Report the path state of a member
+   * \param member the member id
+   * \param baseRtt the member's base RTT, Max if none
+   * \param capacity the member's capacity estimate, zero if none
+   */
+  void UpdatePath (uint32_t member, const Time &baseRtt, const DataRate &capacity);
+  /// \return sum of the members' cwnd (bytes)
+  uint32_t GetCwnd () const;
+  /// \return lowest base RTT of the members, Max if none
+  Time GetBaseRtt () const;
+  /// \return highest capacity estimate of the members, zero if none
+  DataRate GetCapacity () const;
+  /// \return number of members
+  uint32_t GetSize () const;
+
+private:
+  std::vector<uint32_t> m_cWnd;       //!< Last cwnd of each member slot
+  std::vector<Time> m_baseRtt;        //!< Last base RTT of each member slot
+  std::vector<DataRate> m_capacity;   //!< Last capacity of each member slot
+  std::vector<uint32_t> m_free;       //!< Slots of members that left
+  uint64_t m_totalCwnd;               //!< Sum of m_cWnd
+  Time m_groupBaseRtt;                //!< Minimum of m_baseRtt
+  DataRate m_groupCapacity;           //!< Maximum of m_capacity
+};
+
 /**
  * \ingroup tcp
  * \defgroup congestionOps Congestion Control Algorithms.
@@ -59,6 +157,16 @@ namespace ns3 {
 class TcpLibra : public TcpNewReno
 {
 public:
+  /**
+   * \brief Values to detect the Slow Start mode of HyStart
+   */
+  enum HybridSSDetectionMode
+  {
+    PACKET_TRAIN = 1, //!< Detection by trains of packets only
+    DELAY        = 2, //!< Detection by delay value only
+    BOTH         = 3, //!< Detection by delay value and by trains of packets
+  };
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -75,8 +183,31 @@ public:
 
   ~TcpLibra ();
 
+  /**
+   * \brief Callback signature of the Adder trace source
+   * \param cWnd the congestion window after the increase (bytes)
+   * \param adder the increase (bytes)
+   */
+  typedef void (* AdderTracedCallback)(uint32_t cWnd, double adder);
+
+  /**
+   * \brief Send the internals trace sources of every TcpLibra created from
+   * now on to a ring buffer sink
+   *
+   * Each connection connects its sources in Init, under its own flow id.
+   *
+   * \param sink the sink, or 0 to stop connecting new connections
+   */
+  static void SetInternalsSink (TcpLibraTraceRing *sink);
+
   virtual std::string GetName () const;
 
+  /**
+   * \brief Load cached metrics and request ECN when the Ecn attribute is set
+   * \param tcb internal congestion state
+   */
+  virtual void Init (Ptr<TcpSocketState> tcb);
+
   virtual void IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked);
   virtual uint32_t GetSsThresh (Ptr<const TcpSocketState> tcb,
                                 uint32_t bytesInFlight);
@@ -84,29 +215,311 @@ public:
   virtual void PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked,
                           const Time& rtt);
   virtual void HandleWindowForDupAck(Ptr<TcpSocketState> tcb);
+  /**
+   * \brief Start and end the PRR state and the decrease of a recovery episode
+   * \param tcb internal congestion state
+   * \param newState the state being entered
+   */
+  virtual void CongestionStateSet (Ptr<TcpSocketState> tcb,
+                                   const TcpSocketState::TcpCongState_t newState);
+  virtual bool HasCongControl () const;
+  virtual void CongControl (Ptr<TcpSocketState> tcb,
+                            const TcpRateOps::TcpRateConnection &rc,
+                            const TcpRateOps::TcpRateSample &rs);
 
 protected:
   virtual uint32_t SlowStart (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked);
   virtual void CongestionAvoidance (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked);
 private:
-  Time CalculateAvgDelay () const;
-  Time CalculateMaxDelay () const;
-  double CalculateScalabilityFactor() const;
-  // We achieve scalability by adjusting the scalability factor to the capacity of the narrow
-  // link. To compute the latter, we use packet pair techniques that are run embedded into the
-  //  algorithm.
-  double CalculatePenaltyFactor() const;
-  // The penalty factor P has been designed in order to adapt the source sending rate
-  // increase to the network congestion. As usual, congestion is measured by connection
-  // backlog time (i.e. the difference between RTT and minimum RTT).
-  void CalculateAlpha();
+  /**
+   * \brief Start a new RTT round once the ACK covers the round's last segment
+   *
+   * Rolls the core's per-round statistics, then restarts HyStart and folds
+   * the round's marked fraction into the ECN average.
+   *
+   * \param tcb internal congestion state
+   */
+  void UpdateRound (Ptr<TcpSocketState> tcb);
+  /**
+   * \name Attribute accessors
+   *
+   * The Libra parameters are kept in the core only, so these read and write
+   * them there rather than through a copy in TcpLibra.
+   * \{
+   */
+  void SetBaseRttWindow (uint32_t rounds);
+  uint32_t GetBaseRttWindow () const;
+  void SetMaxRttWindow (uint32_t rounds);
+  uint32_t GetMaxRttWindow () const;
+  void SetInitialCapacity (DataRate rate);
+  DataRate GetInitialCapacity () const;
+  void SetCapacityWindow (uint32_t samples);
+  uint32_t GetCapacityWindow () const;
+  void SetDeliveryRateWindow (uint32_t rounds);
+  uint32_t GetDeliveryRateWindow () const;
+  void SetFixedPoint (bool enable);
+  bool GetFixedPoint () const;
+  void SetTableExp (bool enable);
+  bool GetTableExp () const;
+  void SetK1 (double k1);
+  double GetK1 () const;
+  void SetK2 (double k2);
+  double GetK2 () const;
+  void SetT0 (Time t0);
+  Time GetT0 () const;
+  void SetT1 (Time t1);
+  Time GetT1 () const;
+  /** \} */
+  /**
+   * \brief Copy the control law terms to their trace sources after an update
+   */
+  void PublishControlLaw ();
+  /**
+   * \brief Connect the internals trace sources to the ring buffer sink
+   */
+  void ConnectInternalsSink ();
+  /**
+   * \brief Append a record to the TraceFile trace, opening it on first use
+   * \param tcb internal congestion state
+   * \param rtt the RTT sample, zero if none
+   * \param segmentsAcked segments acked
+   * \param event a TcpLibraTraceRecord::Event
+   */
+  void RecordTrace (Ptr<const TcpSocketState> tcb, const Time &rtt, uint32_t segmentsAcked,
+                    uint8_t event);
+  /**
+   * \brief Report new data sent to the core, for the packet-pair probes
+   * \param oldValue the previous high transmit mark
+   * \param newValue the new high transmit mark
+   */
+  void HighTxMarkChanged (SequenceNumber32 oldValue, SequenceNumber32 newValue);
+  /**
+   * \brief Warm start from the cached path state of m_metricsKey, if fresh
+   *
+   * Seeds the core with the cached base RTT, capacity and alpha, takes the
+   * cached ssthresh and starts cwnd at half the cached BDP (bounded by that
+   * ssthresh), so slow start still has a round to notice a changed path.
+   *
+   * \param tcb internal congestion state
+   */
+  void LoadMetrics (Ptr<TcpSocketState> tcb);
+  /**
+   * \brief Write the path state of this connection to the cache entry m_metricsKey
+   * \param tcb internal congestion state
+   */
+  void SaveMetrics (Ptr<const TcpSocketState> tcb);
+  /**
+   * \brief Proportional Rate Reduction (RFC 6937) for one ACK in recovery
+   *
+   * Only needed under CongControl, where the socket leaves recovery to the
+   * congestion control instead of its TcpRecoveryOps. cwnd is set so the
+   * data sent during recovery tracks the data delivered scaled by
+   * ssthresh/RecoverFS, and, once the pipe is below ssthresh, grows back
+   * to it by at most the delivered data plus one segment per ACK
+   * (slow start reduction bound).
+   *
+   * \param tcb internal congestion state
+   * \param rs the rate sample of the current ACK
+   */
+  void PrrUpdate (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \brief Slow start threshold after a Libra decrease of cwnd
+   * \param tcb internal congestion state
+   * \param bytesInFlight bytes in flight at the congestion event
+   * \param scale fraction of the Libra decrease to apply
+   * \return the new ssthresh, at least half the flight and two segments (bytes)
+   */
+  uint32_t Reduce (Ptr<const TcpSocketState> tcb, uint32_t bytesInFlight, double scale);
+  /**
+   * \brief Fraction of the Libra decrease to apply for a loss
+   *
+   * 1 unless loss differentiation is on and the core classifies the loss as
+   * random, then RandomLossScale.
+   *
+   * \return the decrease scale
+   */
+  double LossDecreaseScale ();
+  /**
+   * \brief Fold the marked fraction of the last round into the ECN alpha
+   *
+   * Same estimator as DCTCP: alpha = (1 - g) * alpha + g * F, where F is
+   * the fraction of bytes acked with ECE set during the round.
+   */
+  void UpdateEcnAlpha ();
+  /**
+   * \brief Note a fresh ECN echo, which the socket answers by entering CWR
+   *
+   * The socket sets ECN_ECE_RCVD on a new echo and, unless already in CWR,
+   * asks GetSsThresh for the CWR reduction at once. Flagging the echo here
+   * lets GetSsThresh tell that call from a loss while ECN_ECE_RCVD lingers.
+   *
+   * \param oldValue the previous ECN state
+   * \param newValue the new ECN state
+   */
+  void EcnStateChanged (TcpSocketState::EcnState_t oldValue,
+                        TcpSocketState::EcnState_t newValue);
+  /**
+   * \brief Set the socket pacing rate from cwnd, the base RTT and the capacity
+   *
+   * The rate is cwnd/baseRtt scaled by PacingSsGain in slow start and by
+   * PacingCaGain in congestion avoidance, and never above the estimated
+   * narrow link capacity or the socket's MaxPacingRate.
+   *
+   * \param tcb internal congestion state
+   */
+  void UpdatePacingRate (Ptr<TcpSocketState> tcb);
+  /**
+   * \brief Take the delivery rate, app-limited state and delivered bytes of
+   * a rate sample
+   *
+   * The delivery rate feeds the capacity estimate behind the scalability
+   * factor, in place of the packet-pair samples.
+   *
+   * \param rc the rate connection state
+   * \param rs the rate sample of the current ACK
+   */
+  void UpdateRateSample (const TcpRateOps::TcpRateConnection &rc,
+                         const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \brief Tell whether the application, rather than cwnd, limits the flow
+   *
+   * As in RFC 7661, cwnd is only trusted while the flight it allows is
+   * being used: when the last rate sample was application limited and the
+   * last round delivered less than half of cwnd, the window is not grown.
+   *
+   * \param tcb internal congestion state
+   * \return true if cwnd growth should be held
+   */
+  bool IsAppLimited (Ptr<const TcpSocketState> tcb) const;
+  /**
+   * \brief Restart HyStart detection for a new round
+   */
+  void HystartReset ();
+  /**
+   * \brief Look for the end of slow start in the current RTT sample
+   *
+   * A train of closely spaced ACKs longer than half the base RTT, or a
+   * minimum RTT of the round above the base RTT by more than
+   * clamp (baseRtt/8, HyStartDelayMin, HyStartDelayMax), means the queue
+   * is building; ssthresh is then set to cwnd to leave slow start before
+   * the buffer overflows.
+   *
+   * \param tcb internal congestion state
+   * \param rtt the RTT sample of the current ACK
+   */
+  void HystartUpdate (Ptr<TcpSocketState> tcb, const Time &rtt);
 private:
-  Time m_sumRtt;             //!< Sum of all RTT measurements during last RTT
-  Time m_baseRtt;            //!< Minimum of all RTT measurements
-  Time m_maxRtt;             //!< Maximum of all RTT measurements
-  uint32_t m_cntRtt;         //!< Number of RTT measurements during last RTT
-  double m_alpha;            //!< Additive increase factor
-  Time m_lastRtt;               // Current rtt
+  /// HyStart detection state, held only while in slow start
+  struct HystartState
+  {
+    uint8_t found = 0;          //!< The exit point found by HyStart in this round
+    Time roundStart;            //!< Beginning of the round, for the ACK train
+    Time lastAck;               //!< Last ACK of the current train
+    Time currRtt;               //!< Minimum of the first RTT samples of the round
+    uint32_t sampleCnt = 0;     //!< Number of RTT samples taken this round
+  };
+
+  /// Rate sample state, with the RateSample attribute only
+  struct RateState
+  {
+    bool appLimited = false;           //!< The last rate sample was application limited
+    uint64_t delivered = 0;            //!< Bytes delivered on the connection so far
+    uint64_t roundStartDelivered = 0;  //!< delivered when the current round started
+    uint64_t roundDelivered = 0;       //!< Bytes delivered during the last complete round
+  };
+
+  /// PRR state, for the recovery episode under way only
+  struct PrrState
+  {
+    uint32_t recoverFs = 0;     //!< Bytes in flight when recovery started
+    uint32_t delivered = 0;     //!< Bytes delivered since recovery started
+    uint32_t lost = 0;          //!< Bytes marked lost since recovery started
+  };
+
+  /// DCTCP marked fraction estimator, on ECN-capable connections only
+  struct EcnState
+  {
+    double alpha = 1.0;             //!< Smoothed fraction of ECE-marked bytes
+    uint32_t ackedBytesEcn = 0;     //!< Bytes acked with ECE set this round
+    uint32_t ackedBytesTotal = 0;   //!< Bytes acked this round
+    bool cwrPending = false;        //!< An ECN echo just arrived; the next GetSsThresh enters CWR for it
+  };
+
+  /// Binary ACK trace, with the TraceFile attribute only
+  struct AckTrace
+  {
+    std::string prefix;           //!< Prefix of the trace file
+    TcpLibraTraceWriter writer;   //!< Writer of the trace, opened on first use
+  };
+
+  /// Trace sources, created when the first one is connected
+  struct Traces
+  {
+    uint32_t lawUpdates = 0;                      //!< Core control law updates already published
+    TracedValue<double> alpha {10.0};             //!< Alpha of the control law
+    TracedValue<double> penalty {1.0};            //!< Penalty factor P
+    TracedValue<Time> avgQueueDelay {Time (0)};   //!< Qavg: average RTT minus base RTT
+    TracedValue<Time> maxQueueDelay {Time (0)};   //!< Qmax: maximum RTT minus base RTT
+    TracedValue<Time> baseRtt {Time::Max ()};     //!< Base RTT
+    TracedCallback<uint32_t, double> adder;       //!< Increase of each congestion avoidance ACK
+  };
+
+  template <typename T>
+  friend class TcpLibraTracesAccessor;
+  template <typename T>
+  friend Ptr<const TraceSourceAccessor> MakeTcpLibraTracesAccessor (T Traces::*source);
+
+  /**
+   * \brief The trace sources, created with the current core values on first use
+   * \return the trace sources
+   */
+  Traces &GetTraces ();
+  /**
+   * \name TraceFile attribute accessors
+   * \{
+   */
+  void SetTraceFile (std::string prefix);
+  std::string GetTraceFile () const;
+  /** \} */
+
+  TcpLibraCore<uint32_t, DataRate> m_core; //!< The Libra control law, RTTs in microseconds
+  bool m_pacing;             //!< Set the socket pacing rate instead of leaving it to the socket's attributes
+  double m_pacingSsGain;     //!< Pacing gain in slow start
+  double m_pacingCaGain;     //!< Pacing gain in congestion avoidance
+  bool m_hystart;            //!< Enable or disable HyStart algorithm
+  HybridSSDetectionMode m_hystartDetect; //!< Detect way for HyStart algorithm
+  uint32_t m_hystartLowWindow; //!< Lower bound cWnd for hybrid slow start (segments)
+  uint32_t m_hystartMinSamples; //!< Number of delay samples for detecting the increase of delay
+  Time m_hystartAckDelta;    //!< Spacing between ACKs indicating train
+  Time m_hystartDelayMin;    //!< Minimum time for HyStart algorithm
+  Time m_hystartDelayMax;    //!< Maximum time for HyStart algorithm
+  bool m_rateSample;           //!< Consume the TcpRateOps rate samples
+  bool m_ecn;                  //!< Negotiate ECN on the connection
+  Time m_targetDelay;          //!< Queuing delay target, zero for the plain Libra law
+  uint32_t m_couplingGroup;    //!< Coupling group id, 0 for an uncoupled flow
+  Ptr<TcpLibraGroup> m_group;  //!< The coupling group, null if uncoupled
+  uint32_t m_groupMember;      //!< Member id in m_group
+  bool m_prr;                  //!< Reduce once per recovery episode, spread by PRR
+  bool m_episodeDecrease;      //!< The decrease of the current episode is taken
+  bool m_lossDiff;             //!< Classify losses and soften random ones
+  double m_lossDiffThreshold;  //!< Queuing delay fraction above which a loss is congestive
+  double m_randomLossScale;    //!< Fraction of the decrease applied on a random loss
+  uint32_t m_randomLosses;     //!< Losses classified as random
+  bool m_metricsCache;         //!< Share path state across the node's connections
+  Time m_metricsTimeout;       //!< Age after which a cache entry is ignored
+  uint32_t m_metricsKey;       //!< Cache entry of the connection, NO_CONTEXT before Init
+  Ptr<TcpSocketState> m_tcb;   //!< State of the connection, null before Init
+  uint32_t m_abcLimit;         //!< Byte counting limit L in slow start (segments)
+  bool m_byteCounting;         //!< Scale the congestion avoidance increase by segments acked
+  bool m_ackFilter;            //!< Keep only the lowest RTT of a compressed ACK burst
+  double m_ecnG;               //!< Gain of the marked fraction average
+  double m_ecnAlphaOnInit;     //!< Initial marked fraction average
+  std::unique_ptr<HystartState> m_hs;   //!< HyStart state, null outside slow start
+  std::unique_ptr<RateState> m_rate;    //!< Rate sample state, null without RateSample
+  std::unique_ptr<PrrState> m_prrState; //!< PRR state, null outside a PRR recovery episode
+  std::unique_ptr<EcnState> m_ecnState; //!< ECN state, null unless the connection uses ECN
+  std::unique_ptr<AckTrace> m_ackTrace; //!< ACK trace, null without TraceFile
+  std::unique_ptr<Traces> m_traces;     //!< Trace sources, null until one is connected
 };
 
 } // namespace ns3